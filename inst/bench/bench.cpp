@@ -0,0 +1,339 @@
+/********************************************************
+ * Purpose: Standalone benchmarks for the sampling kernels,
+ * run outside of R on synthetic graphs with county structure.
+ * Build and usage instructions are in README.md.
+ ********************************************************/
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+
+#include "bench_alloc.h"
+#include "bench_graphs.h"
+#include "smc.h"
+#include "map_calc.h"
+#include "labeling.h"
+
+// Allocation counting ----------------------------------
+
+static std::atomic<size_t> n_allocs(0);
+
+void *bench_alloc(std::size_t n_bytes) {
+    n_allocs++;
+    return std::malloc(n_bytes);
+}
+
+void bench_free(void *ptr) {
+    std::free(ptr);
+}
+
+void *operator new(std::size_t n_bytes) {
+    n_allocs++;
+    void *ptr = std::malloc(n_bytes > 0 ? n_bytes : 1);
+    if (ptr == nullptr) throw std::bad_alloc();
+    return ptr;
+}
+
+void operator delete(void *ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
+
+// Harness ----------------------------------------------
+
+typedef std::chrono::steady_clock bench_clock;
+
+/*
+ * Call `fn` `reps` times and report the number of `unit`s it returns per
+ * second, along with the number of heap allocations per call
+ */
+template <typename F>
+void bench(const char *name, const char *graph, int V, int reps,
+           const char *unit, F fn) {
+    size_t allocs_start = n_allocs.load();
+    double n_units = 0;
+    auto start = bench_clock::now();
+    for (int i = 0; i < reps; i++) {
+        n_units += fn();
+    }
+    std::chrono::duration<double> elapsed = bench_clock::now() - start;
+    double allocs = (double) (n_allocs.load() - allocs_start) / reps;
+
+    std::printf("%-22s %-7s %9d %14.1f %-10s %12.1f\n", name, graph, V,
+                n_units / elapsed.count(), unit, allocs);
+    std::fflush(stdout);
+}
+
+/*
+ * Draw a full plan by repeated calls to `split_map`, as a single SMC particle
+ * would. Returns false if some split fails too many times in a row.
+ */
+static bool draw_plan(const BenchMap &m, Multigraph &cg, subview_col<uword> plan,
+                      int n_distr, double target, double lower, double upper,
+                      int k) {
+    const int max_try = 1000;
+    int n_abort = 0;
+    double pop_left = sum(m.pop);
+    plan.zeros();
+    for (int ctr = 1; ctr < n_distr; ctr++) {
+        int new_size = n_distr - ctr;
+        double lower_s = std::max(lower, pop_left - new_size * upper);
+        double upper_s = std::min(upper, pop_left - new_size * lower);
+        int i;
+        for (i = 0; i < max_try; i++) {
+            double new_pop = lower_s;
+            double inc_lp = split_map(m.g, m.counties, cg, plan, ctr, m.pop,
+                                      pop_left, new_pop, upper_s, target, k,
+                                      false, n_abort);
+            if (std::isfinite(inc_lp)) {
+                pop_left -= new_pop;
+                break;
+            }
+        }
+        if (i == max_try) return false;
+    }
+
+    int V = m.g.size();
+    for (int j = 0; j < V; j++) {
+        if (plan[j] == 0) plan[j] = n_distr;
+    }
+    return true;
+}
+
+/*
+ * Run every kernel benchmark on map `m`
+ */
+static void bench_map(const BenchMap &m, const char *graph, int n_distr, int n_plans) {
+    int V = m.g.size();
+    Multigraph cg = county_graph(m.g, m.counties);
+    int n_cty = max(m.counties);
+    double total_pop = sum(m.pop);
+    double target = total_pop / n_distr;
+    double tol = 0.05;
+    double lower = target * (1 - tol);
+    double upper = target * (1 + tol);
+    int reps = std::max(3, (int) (2e6 / V));
+    std::vector<bool> ignore(V, false);
+
+    // crude version of `adapt_parameters()`: largest number of
+    // acceptable edges seen over a few trees
+    int k = 1;
+    int root;
+    for (int i = 0; i < 20; i++) {
+        Tree ust = init_tree(V);
+        ust = sample_sub_ust(m.g, ust, V, root, ignore, m.pop, lower, upper,
+                             m.counties, cg, false);
+        if (ust.size() == 0) continue;
+        std::vector<double> devs = tree_dev(ust, root, m.pop, total_pop, target);
+        int n_ok = 0;
+        while (n_ok < V - 1 && devs[n_ok] <= tol) n_ok++;
+        k = std::max(k, n_ok);
+    }
+
+    bench("sample_sub_ust", graph, V, reps, "trees/s", [&] () -> double {
+        Tree ust = init_tree(V);
+        ust = sample_sub_ust(m.g, ust, V, root, ignore, m.pop, lower, upper,
+                             m.counties, cg, false);
+        return ust.size() > 0;
+    });
+
+    Tree base_ust;
+    int base_root;
+    do {
+        base_ust = init_tree(V);
+        base_ust = sample_sub_ust(m.g, base_ust, V, base_root, ignore, m.pop,
+                                  lower, upper, m.counties, cg, false);
+    } while (base_ust.size() == 0);
+    umat cut_plan(V, 1, fill::zeros);
+    bench("cut_districts+copy", graph, V, reps, "cuts/s", [&] () -> double {
+        Tree ust = base_ust;
+        cut_plan.zeros();
+        subview_col<uword> col = cut_plan.col(0);
+        int n_ok;
+        cut_districts(ust, k, base_root, col, 1, m.pop, total_pop,
+                      lower, upper, target, false, n_ok);
+        return 1.0;
+    });
+
+    umat split_plan(V, 1, fill::zeros);
+    int n_abort = 0;
+    bench("split_map", graph, V, reps, "splits/s", [&] () -> double {
+        split_plan.zeros();
+        double new_pop = lower;
+        double inc_lp = split_map(m.g, m.counties, cg, split_plan.col(0), 1,
+                                  m.pop, total_pop, new_pop, upper, target, k,
+                                  false, n_abort);
+        return std::isfinite(inc_lp);
+    });
+    bench("split_map (mtry)", graph, V, reps, "splits/s", [&] () -> double {
+        split_plan.zeros();
+        double new_pop = lower;
+        double inc_lp = split_map(m.g, m.counties, cg, split_plan.col(0), 1,
+                                  m.pop, total_pop, new_pop, upper, target, k,
+                                  true, n_abort);
+        return std::isfinite(inc_lp);
+    });
+
+    umat plans(V, n_plans, fill::zeros);
+    int plan_i = 0;
+    bench("draw_plan", graph, V, n_plans, "plans/s", [&] () -> double {
+        bool ok = draw_plan(m, cg, plans.col(plan_i), n_distr, target,
+                            lower, upper, k);
+        plan_i += ok;
+        return ok;
+    });
+    if (plan_i < 2) {
+        std::printf("  (too few plans drawn on %s graph with V=%d; skipping rest)\n",
+                    graph, V);
+        return;
+    }
+    plans = plans.cols(0, plan_i - 1);
+
+    uvec plan_0 = plans.col(0);
+    Graph dist_g = district_graph(m.g, plan_0, n_distr);
+    if (n_distr <= 13) {
+        bench("log_labelings_exact", graph, V, 10, "graphs/s", [&] () -> double {
+            log_labelings_exact(dist_g);
+            return 1.0;
+        });
+    }
+    bench("log_labelings_IS", graph, V, 10, "graphs/s", [&] () -> double {
+        log_labelings_IS(dist_g, 100);
+        return 1.0;
+    });
+
+    // constraint data
+    uvec grp_pop = m.pop / 3;
+    uvec current = plans.col(1);
+    uvec cities(V);
+    for (int i = 0; i < V; i++) {
+        cities[i] = m.counties[i] % 5 == 0 ? m.counties[i] / 5 : 0;
+    }
+    int n_city = max(cities);
+    vec tgts_grp = {0.3, 0.55};
+    const subview_col<uword> plan = plans.col(0);
+
+    // each call evaluates every district of one plan
+    auto bench_constr = [&] (const char *name, std::function<double(int)> fn) {
+        bench(name, graph, V, std::max(3, reps / n_distr), "distr/s", [&] () -> double {
+            for (int d = 1; d <= n_distr; d++) fn(d);
+            return n_distr;
+        });
+    };
+    bench_constr("eval_pop_dev", [&] (int d) {
+        return eval_pop_dev(plan, d, m.pop, target);
+    });
+    bench_constr("eval_splits", [&] (int d) {
+        return eval_splits(plan, d, m.counties, n_cty, false);
+    });
+    bench_constr("eval_multisplits", [&] (int d) {
+        return eval_multisplits(plan, d, m.counties, n_cty, false);
+    });
+    bench_constr("eval_total_splits", [&] (int d) {
+        return eval_total_splits(plan, d, m.counties, n_cty);
+    });
+    bench_constr("eval_grp_hinge", [&] (int d) {
+        return eval_grp_hinge(plan, d, tgts_grp, grp_pop, m.pop);
+    });
+    bench_constr("eval_grp_pow", [&] (int d) {
+        return eval_grp_pow(plan, d, grp_pop, m.pop, 0.55, 0.25, 1.0);
+    });
+    bench_constr("eval_segregation", [&] (int d) {
+        return eval_segregation(plan, d, grp_pop, m.pop);
+    });
+    bench_constr("eval_sq_entropy", [&] (int d) {
+        return eval_sq_entropy(plan, current, d, m.pop, n_distr, n_distr, V);
+    });
+    bench_constr("eval_polsby", [&] (int d) {
+        return eval_polsby(plan, d, m.from, m.to, m.area, m.perimeter);
+    });
+    bench_constr("eval_qps", [&] (int d) {
+        return eval_qps(plan, d, m.pop, cities, n_city, n_distr);
+    });
+    mat tally_x = join_cols(conv_to<rowvec>::from(m.pop), conv_to<rowvec>::from(grp_pop),
+                            m.area.t());
+    bench("tally_districts", graph, V, reps, "plans/s", [&] () -> double {
+        mat sums = tally_districts(plan, tally_x, n_distr);
+        return 1.0;
+    });
+    if (V <= 5000) { // dense V x V distance matrix
+        mat ssdmat(V, V);
+        for (int i = 0; i < V; i++) {
+            for (int j = 0; j < V; j++) {
+                ssdmat(i, j) = std::pow(m.x[i] - m.x[j], 2.0) + std::pow(m.y[i] - m.y[j], 2.0);
+            }
+        }
+        bench_constr("eval_fry_hold", [&] (int d) {
+            return eval_fry_hold(plan, d, m.pop, ssdmat, 1.0);
+        });
+    }
+
+    if (V <= 10000) { // quadratic in V
+        int n = plans.n_cols;
+        uvec idxs(n);
+        for (int i = 0; i < n; i++) idxs[i] = i + 1;
+        bench("prec_cooccur", graph, V, 3, "cmp/s", [&] () -> double {
+            prec_cooccur(plans, idxs, 0);
+            return 0.5 * V * (V - 1.0) * n;
+        });
+    }
+}
+
+static void usage() {
+    std::printf("Usage: bench [--graph grid|planar|both] [--districts N] "
+                "[--plans N] [--seed S] [V ...]\n");
+}
+
+int main(int argc, char **argv) {
+    std::vector<int> sizes;
+    std::string graph = "both";
+    int n_distr = 10;
+    int n_plans = 20;
+    uint32_t seed = 2023;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--graph") == 0 && i + 1 < argc) {
+            graph = argv[++i];
+        } else if (std::strcmp(argv[i], "--districts") == 0 && i + 1 < argc) {
+            n_distr = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--plans") == 0 && i + 1 < argc) {
+            n_plans = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = std::atoi(argv[++i]);
+        } else if (argv[i][0] == '-') {
+            usage();
+            return 1;
+        } else {
+            sizes.push_back(std::atoi(argv[i]));
+        }
+    }
+    if (sizes.empty()) sizes = {1000, 10000, 100000, 1000000};
+    if (n_distr < 2 || n_plans < 2) {
+        usage();
+        return 1;
+    }
+
+    seed_rng(seed);
+    std::printf("%-22s %-7s %9s %14s %-10s %12s\n", "kernel", "graph", "V",
+                "rate", "unit", "allocs/call");
+    for (int V : sizes) {
+        int side = std::max(4, (int) std::round(std::sqrt((double) V)));
+        int cty_side = std::max(2, side / 20); // about 400 counties
+        if (graph == "grid" || graph == "both") {
+            BenchMap m = grid_map(side, cty_side, seed);
+            bench_map(m, "grid", n_distr, n_plans);
+        }
+        if (graph == "planar" || graph == "both") {
+            BenchMap m = planar_map(side, cty_side, 0.5, 0.1, seed);
+            bench_map(m, "planar", n_distr, n_plans);
+        }
+    }
+
+    return 0;
+}
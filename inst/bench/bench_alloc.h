@@ -0,0 +1,13 @@
+#ifndef BENCH_ALLOC_H
+#define BENCH_ALLOC_H
+
+#include <cstddef>
+
+/*
+ * Counting allocator hooks. This header is force-included into every
+ * translation unit so that Armadillo routes its heap buffers through them.
+ */
+void *bench_alloc(std::size_t n_bytes);
+void bench_free(void *ptr);
+
+#endif
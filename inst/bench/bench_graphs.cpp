@@ -0,0 +1,140 @@
+#include "bench_graphs.h"
+
+#include <algorithm>
+#include <random>
+#include <numeric>
+
+// shared setup for lattice-based maps: populations, counties, coordinates,
+// and unit-square perimeters
+static BenchMap lattice_base(int side, int cty_side, std::mt19937 &gen) {
+    int V = side * side;
+    int cty_per_row = (side + cty_side - 1) / cty_side;
+    std::uniform_int_distribution<int> pop_dist(500, 1500);
+
+    BenchMap m;
+    m.g = Graph(V);
+    m.pop = uvec(V);
+    m.counties = uvec(V);
+    m.x = vec(V);
+    m.y = vec(V);
+    m.area = vec(V);
+    m.area.fill(1.0 / V);
+
+    int n_edge = 4 * V;
+    m.from = ivec(n_edge);
+    m.to = ivec(n_edge);
+    m.perimeter = vec(n_edge);
+    m.perimeter.fill(1.0 / side);
+
+    const int dr[4] = {-1, 1, 0, 0};
+    const int dc[4] = {0, 0, -1, 1};
+    int e = 0;
+    for (int r = 0; r < side; r++) {
+        for (int c = 0; c < side; c++) {
+            int i = r * side + c;
+            m.pop[i] = pop_dist(gen);
+            m.counties[i] = (r / cty_side) * cty_per_row + c / cty_side + 1;
+            m.x[i] = (c + 0.5) / side;
+            m.y[i] = (r + 0.5) / side;
+            for (int s = 0; s < 4; s++, e++) {
+                int rr = r + dr[s];
+                int cc = c + dc[s];
+                bool inside = rr >= 0 && rr < side && cc >= 0 && cc < side;
+                m.from[e] = inside ? rr * side + cc + 1 : -1; // 1-indexed
+                m.to[e] = i + 1;
+            }
+        }
+    }
+
+    return m;
+}
+
+/*
+ * Square `side` x `side` rook-adjacency grid, with square counties of
+ * `cty_side` x `cty_side` units
+ */
+BenchMap grid_map(int side, int cty_side, uint32_t seed) {
+    std::mt19937 gen(seed);
+    BenchMap m = lattice_base(side, cty_side, gen);
+
+    for (int r = 0; r < side; r++) {
+        for (int c = 0; c < side; c++) {
+            int i = r * side + c;
+            if (r > 0) m.g[i].push_back(i - side);
+            if (c > 0) m.g[i].push_back(i - 1);
+            if (c < side - 1) m.g[i].push_back(i + 1);
+            if (r < side - 1) m.g[i].push_back(i + side);
+        }
+    }
+
+    return m;
+}
+
+// union-find helper
+static int uf_find(std::vector<int> &parent, int i) {
+    while (parent[i] != i) {
+        parent[i] = parent[parent[i]];
+        i = parent[i];
+    }
+    return i;
+}
+
+/*
+ * Random planar graph on a `side` x `side` lattice: every cell gets one of its
+ * two diagonals with probability `p_diag`, and lattice edges are dropped with
+ * probability `p_drop` as long as the graph stays connected.
+ */
+BenchMap planar_map(int side, int cty_side, double p_diag, double p_drop,
+                    uint32_t seed) {
+    std::mt19937 gen(seed);
+    std::uniform_real_distribution<double> unif(0.0, 1.0);
+    BenchMap m = lattice_base(side, cty_side, gen);
+    int V = side * side;
+
+    std::vector<std::pair<int, int>> edges;
+    edges.reserve(4 * V);
+    for (int r = 0; r < side; r++) {
+        for (int c = 0; c < side; c++) {
+            int i = r * side + c;
+            if (c < side - 1) edges.push_back({i, i + 1});
+            if (r < side - 1) edges.push_back({i, i + side});
+        }
+    }
+    std::shuffle(edges.begin(), edges.end(), gen);
+    // within-county edges first, so that every county stays connected
+    std::stable_partition(edges.begin(), edges.end(), [&] (const std::pair<int, int> &e) {
+        return m.counties[e.first] == m.counties[e.second];
+    });
+
+    // a random spanning forest is always kept, so dropping the rest is safe
+    std::vector<int> parent(V);
+    std::iota(parent.begin(), parent.end(), 0);
+    for (const auto &edge : edges) {
+        int a = uf_find(parent, edge.first);
+        int b = uf_find(parent, edge.second);
+        if (a != b) {
+            parent[a] = b;
+        } else if (unif(gen) < p_drop) {
+            continue;
+        }
+        m.g[edge.first].push_back(edge.second);
+        m.g[edge.second].push_back(edge.first);
+    }
+
+    // one diagonal per cell keeps the graph planar
+    for (int r = 0; r < side - 1; r++) {
+        for (int c = 0; c < side - 1; c++) {
+            if (unif(gen) >= p_diag) continue;
+            int i = r * side + c;
+            if (unif(gen) < 0.5) {
+                m.g[i].push_back(i + side + 1);
+                m.g[i + side + 1].push_back(i);
+            } else {
+                m.g[i + 1].push_back(i + side);
+                m.g[i + side].push_back(i + 1);
+            }
+        }
+    }
+
+    return m;
+}
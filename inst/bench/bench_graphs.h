@@ -0,0 +1,37 @@
+#ifndef BENCH_GRAPHS_H
+#define BENCH_GRAPHS_H
+
+#include "smc_base.h"
+
+/*
+ * A synthetic redistricting problem: adjacency graph, unit populations,
+ * county labels (1-indexed) and the unit-square coordinates of each unit.
+ */
+struct BenchMap {
+    Graph g;
+    uvec pop;
+    uvec counties;
+    vec x;
+    vec y;
+    // perimeter data in the format of `redistmetrics::prep_perims()`
+    ivec from;
+    ivec to;
+    vec area;
+    vec perimeter;
+};
+
+/*
+ * Square `side` x `side` rook-adjacency grid, with square counties of
+ * `cty_side` x `cty_side` units
+ */
+BenchMap grid_map(int side, int cty_side, uint32_t seed);
+
+/*
+ * Random planar graph on a `side` x `side` lattice: every cell gets one of its
+ * two diagonals with probability `p_diag`, and lattice edges are dropped with
+ * probability `p_drop` as long as the graph stays connected.
+ */
+BenchMap planar_map(int side, int cty_side, double p_diag, double p_drop,
+                    uint32_t seed);
+
+#endif
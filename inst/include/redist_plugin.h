@@ -0,0 +1,88 @@
+#ifndef REDIST_PLUGIN_H
+#define REDIST_PLUGIN_H
+
+/*
+ * Compiled constraints for redist samplers.
+ *
+ * A package can write a constraint in C++ by deriving from
+ * `redist::constr_plugin`, and hand it to `add_constr_plugin()` as an external
+ * pointer made with `redist::make_plugin()`. The package should list redist
+ * and RcppArmadillo under LinkingTo, and be compiled with ARMA_64BIT_WORD=1
+ * (as redist is) so that plans have the same element type on both sides.
+ *
+ *     // [[Rcpp::depends(RcppArmadillo, redist)]]
+ *     #include <redist_plugin.h>
+ *
+ *     class unit_seven : public redist::constr_plugin {
+ *     public:
+ *         double eval_district(const arma::subview_col<arma::uword> &plan,
+ *                              int distr) const {
+ *             return plan[6] == 2;
+ *         }
+ *     };
+ *
+ *     // [[Rcpp::export]]
+ *     SEXP unit_seven_ptr() {
+ *         return redist::make_plugin<unit_seven>();
+ *     }
+ */
+
+#include <utility>
+#include <RcppArmadillo.h>
+
+static_assert(sizeof(arma::uword) == 8,
+              "redist plugins must be compiled with ARMA_64BIT_WORD=1");
+
+namespace redist {
+
+/*
+ * A constraint evaluated one district at a time, like the built-in ones.
+ *
+ * Plans use the labels of the sampler: districts are numbered from 1, and in
+ * `redist_smc()` units which are not yet assigned to a district are labeled 0
+ * (and district 0 is evaluated at the last step). The value for `distr` should
+ * depend only on the units assigned to it.
+ *
+ * `eval_district()` and `delta()` may be called from several threads at once,
+ * so they must not touch R objects or modify shared state.
+ */
+class constr_plugin {
+public:
+    virtual ~constr_plugin() {}
+
+    /*
+     * Called once on the main thread before sampling, with the unit
+     * populations and number of districts
+     */
+    virtual void init(const arma::uvec &pop, int n_distr) {}
+
+    /*
+     * Value of the constraint for district `distr` of `plan`, where 0
+     * means no penalty
+     */
+    virtual double eval_district(const arma::subview_col<arma::uword> &plan,
+                                 int distr) const = 0;
+
+    /*
+     * Change in the value for district `distr` when `plan` is replaced by
+     * `new_plan`. Override this when the change can be found more cheaply
+     * than by evaluating both plans.
+     */
+    virtual double delta(const arma::subview_col<arma::uword> &plan,
+                         const arma::subview_col<arma::uword> &new_plan,
+                         int distr) const {
+        return eval_district(new_plan, distr) - eval_district(plan, distr);
+    }
+};
+
+/*
+ * Make an external pointer to a new `T`, for `add_constr_plugin()`
+ */
+template <typename T, typename... Args>
+Rcpp::XPtr<constr_plugin> make_plugin(Args&&... args) {
+    return Rcpp::XPtr<constr_plugin>(new T(std::forward<Args>(args)...), true);
+}
+
+} // namespace redist
+
+#endif
@@ -77,8 +77,8 @@ BEGIN_RCPP
 END_RCPP
 }
 // polsbypopper
-NumericMatrix polsbypopper(IntegerVector from, IntegerVector to, NumericVector area, NumericVector perimeter, IntegerMatrix dm, int nd);
-RcppExport SEXP _redist_polsbypopper(SEXP fromSEXP, SEXP toSEXP, SEXP areaSEXP, SEXP perimeterSEXP, SEXP dmSEXP, SEXP ndSEXP) {
+NumericMatrix polsbypopper(IntegerVector from, IntegerVector to, NumericVector area, NumericVector perimeter, IntegerMatrix dm, int nd, int ncores);
+RcppExport SEXP _redist_polsbypopper(SEXP fromSEXP, SEXP toSEXP, SEXP areaSEXP, SEXP perimeterSEXP, SEXP dmSEXP, SEXP ndSEXP, SEXP ncoresSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
@@ -88,7 +88,8 @@ BEGIN_RCPP
     Rcpp::traits::input_parameter< NumericVector >::type perimeter(perimeterSEXP);
     Rcpp::traits::input_parameter< IntegerMatrix >::type dm(dmSEXP);
     Rcpp::traits::input_parameter< int >::type nd(ndSEXP);
-    rcpp_result_gen = Rcpp::wrap(polsbypopper(from, to, area, perimeter, dm, nd));
+    Rcpp::traits::input_parameter< int >::type ncores(ncoresSEXP);
+    rcpp_result_gen = Rcpp::wrap(polsbypopper(from, to, area, perimeter, dm, nd, ncores));
     return rcpp_result_gen;
 END_RCPP
 }
@@ -290,6 +291,21 @@ BEGIN_RCPP
     return rcpp_result_gen;
 END_RCPP
 }
+// prec_cooccur_pairs
+NumericVector prec_cooccur_pairs(arma::umat m, arma::uvec idxs, arma::uvec i, arma::uvec j, int ncores);
+RcppExport SEXP _redist_prec_cooccur_pairs(SEXP mSEXP, SEXP idxsSEXP, SEXP iSEXP, SEXP jSEXP, SEXP ncoresSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< arma::umat >::type m(mSEXP);
+    Rcpp::traits::input_parameter< arma::uvec >::type idxs(idxsSEXP);
+    Rcpp::traits::input_parameter< arma::uvec >::type i(iSEXP);
+    Rcpp::traits::input_parameter< arma::uvec >::type j(jSEXP);
+    Rcpp::traits::input_parameter< int >::type ncores(ncoresSEXP);
+    rcpp_result_gen = Rcpp::wrap(prec_cooccur_pairs(m, idxs, i, j, ncores));
+    return rcpp_result_gen;
+END_RCPP
+}
 // group_pct
 NumericMatrix group_pct(arma::umat m, arma::vec group_pop, arma::vec total_pop, int n_distr);
 RcppExport SEXP _redist_group_pct(SEXP mSEXP, SEXP group_popSEXP, SEXP total_popSEXP, SEXP n_distrSEXP) {
@@ -331,14 +347,57 @@ BEGIN_RCPP
 END_RCPP
 }
 // ms_plans
-Rcpp::List ms_plans(int N, List l, const arma::uvec init, const arma::uvec& counties, const arma::uvec& pop, int n_distr, double target, double lower, double upper, double rho, List constraints, double thresh, int k, int thin, int verbosity);
-RcppExport SEXP _redist_ms_plans(SEXP NSEXP, SEXP lSEXP, SEXP initSEXP, SEXP countiesSEXP, SEXP popSEXP, SEXP n_distrSEXP, SEXP targetSEXP, SEXP lowerSEXP, SEXP upperSEXP, SEXP rhoSEXP, SEXP constraintsSEXP, SEXP threshSEXP, SEXP kSEXP, SEXP thinSEXP, SEXP verbositySEXP) {
+Rcpp::List ms_plans(int N, List l, const arma::umat init, const arma::uvec& counties, const arma::uvec& pop, int n_distr, double target, double lower, double upper, double rho, List constraints, double thresh, int k, int thin, int ncores, int verbosity, bool deltas);
+RcppExport SEXP _redist_ms_plans(SEXP NSEXP, SEXP lSEXP, SEXP initSEXP, SEXP countiesSEXP, SEXP popSEXP, SEXP n_distrSEXP, SEXP targetSEXP, SEXP lowerSEXP, SEXP upperSEXP, SEXP rhoSEXP, SEXP constraintsSEXP, SEXP threshSEXP, SEXP kSEXP, SEXP thinSEXP, SEXP ncoresSEXP, SEXP verbositySEXP, SEXP deltasSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< int >::type N(NSEXP);
+    Rcpp::traits::input_parameter< List >::type l(lSEXP);
+    Rcpp::traits::input_parameter< const arma::umat >::type init(initSEXP);
+    Rcpp::traits::input_parameter< const arma::uvec& >::type counties(countiesSEXP);
+    Rcpp::traits::input_parameter< const arma::uvec& >::type pop(popSEXP);
+    Rcpp::traits::input_parameter< int >::type n_distr(n_distrSEXP);
+    Rcpp::traits::input_parameter< double >::type target(targetSEXP);
+    Rcpp::traits::input_parameter< double >::type lower(lowerSEXP);
+    Rcpp::traits::input_parameter< double >::type upper(upperSEXP);
+    Rcpp::traits::input_parameter< double >::type rho(rhoSEXP);
+    Rcpp::traits::input_parameter< List >::type constraints(constraintsSEXP);
+    Rcpp::traits::input_parameter< double >::type thresh(threshSEXP);
+    Rcpp::traits::input_parameter< int >::type k(kSEXP);
+    Rcpp::traits::input_parameter< int >::type thin(thinSEXP);
+    Rcpp::traits::input_parameter< int >::type ncores(ncoresSEXP);
+    Rcpp::traits::input_parameter< int >::type verbosity(verbositySEXP);
+    Rcpp::traits::input_parameter< bool >::type deltas(deltasSEXP);
+    rcpp_result_gen = Rcpp::wrap(ms_plans(N, l, init, counties, pop, n_distr, target, lower, upper, rho, constraints, thresh, k, thin, ncores, verbosity, deltas));
+    return rcpp_result_gen;
+END_RCPP
+}
+// decode_ms_deltas
+arma::umat decode_ms_deltas(arma::uvec plan, int from, const std::vector<int>& ptr, const std::vector<int>& vtx, const std::vector<int>& distr, const std::vector<int>& idxs);
+RcppExport SEXP _redist_decode_ms_deltas(SEXP planSEXP, SEXP fromSEXP, SEXP ptrSEXP, SEXP vtxSEXP, SEXP distrSEXP, SEXP idxsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< arma::uvec >::type plan(planSEXP);
+    Rcpp::traits::input_parameter< int >::type from(fromSEXP);
+    Rcpp::traits::input_parameter< const std::vector<int>& >::type ptr(ptrSEXP);
+    Rcpp::traits::input_parameter< const std::vector<int>& >::type vtx(vtxSEXP);
+    Rcpp::traits::input_parameter< const std::vector<int>& >::type distr(distrSEXP);
+    Rcpp::traits::input_parameter< const std::vector<int>& >::type idxs(idxsSEXP);
+    rcpp_result_gen = Rcpp::wrap(decode_ms_deltas(plan, from, ptr, vtx, distr, idxs));
+    return rcpp_result_gen;
+END_RCPP
+}
+// ms_tempered
+Rcpp::List ms_tempered(int N, List l, const arma::umat init, const arma::uvec& counties, const arma::uvec& pop, int n_distr, double target, double lower, double upper, double rho, List constraints, const arma::vec betas, int swap_every, double thresh, int k, int thin, int ncores, int verbosity);
+RcppExport SEXP _redist_ms_tempered(SEXP NSEXP, SEXP lSEXP, SEXP initSEXP, SEXP countiesSEXP, SEXP popSEXP, SEXP n_distrSEXP, SEXP targetSEXP, SEXP lowerSEXP, SEXP upperSEXP, SEXP rhoSEXP, SEXP constraintsSEXP, SEXP betasSEXP, SEXP swap_everySEXP, SEXP threshSEXP, SEXP kSEXP, SEXP thinSEXP, SEXP ncoresSEXP, SEXP verbositySEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
     Rcpp::traits::input_parameter< int >::type N(NSEXP);
     Rcpp::traits::input_parameter< List >::type l(lSEXP);
-    Rcpp::traits::input_parameter< const arma::uvec >::type init(initSEXP);
+    Rcpp::traits::input_parameter< const arma::umat >::type init(initSEXP);
     Rcpp::traits::input_parameter< const arma::uvec& >::type counties(countiesSEXP);
     Rcpp::traits::input_parameter< const arma::uvec& >::type pop(popSEXP);
     Rcpp::traits::input_parameter< int >::type n_distr(n_distrSEXP);
@@ -347,11 +406,34 @@ BEGIN_RCPP
     Rcpp::traits::input_parameter< double >::type upper(upperSEXP);
     Rcpp::traits::input_parameter< double >::type rho(rhoSEXP);
     Rcpp::traits::input_parameter< List >::type constraints(constraintsSEXP);
+    Rcpp::traits::input_parameter< const arma::vec >::type betas(betasSEXP);
+    Rcpp::traits::input_parameter< int >::type swap_every(swap_everySEXP);
     Rcpp::traits::input_parameter< double >::type thresh(threshSEXP);
     Rcpp::traits::input_parameter< int >::type k(kSEXP);
     Rcpp::traits::input_parameter< int >::type thin(thinSEXP);
+    Rcpp::traits::input_parameter< int >::type ncores(ncoresSEXP);
     Rcpp::traits::input_parameter< int >::type verbosity(verbositySEXP);
-    rcpp_result_gen = Rcpp::wrap(ms_plans(N, l, init, counties, pop, n_distr, target, lower, upper, rho, constraints, thresh, k, thin, verbosity));
+    rcpp_result_gen = Rcpp::wrap(ms_tempered(N, l, init, counties, pop, n_distr, target, lower, upper, rho, constraints, betas, swap_every, thresh, k, thin, ncores, verbosity));
+    return rcpp_result_gen;
+END_RCPP
+}
+// ms_adapt_k
+int ms_adapt_k(List l, const arma::uvec& plan, const arma::uvec& counties, const arma::uvec& pop, int n_distr, double target, double lower, double upper, double thresh, int ncores);
+RcppExport SEXP _redist_ms_adapt_k(SEXP lSEXP, SEXP planSEXP, SEXP countiesSEXP, SEXP popSEXP, SEXP n_distrSEXP, SEXP targetSEXP, SEXP lowerSEXP, SEXP upperSEXP, SEXP threshSEXP, SEXP ncoresSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< List >::type l(lSEXP);
+    Rcpp::traits::input_parameter< const arma::uvec& >::type plan(planSEXP);
+    Rcpp::traits::input_parameter< const arma::uvec& >::type counties(countiesSEXP);
+    Rcpp::traits::input_parameter< const arma::uvec& >::type pop(popSEXP);
+    Rcpp::traits::input_parameter< int >::type n_distr(n_distrSEXP);
+    Rcpp::traits::input_parameter< double >::type target(targetSEXP);
+    Rcpp::traits::input_parameter< double >::type lower(lowerSEXP);
+    Rcpp::traits::input_parameter< double >::type upper(upperSEXP);
+    Rcpp::traits::input_parameter< double >::type thresh(threshSEXP);
+    Rcpp::traits::input_parameter< int >::type ncores(ncoresSEXP);
+    rcpp_result_gen = Rcpp::wrap(ms_adapt_k(l, plan, counties, pop, n_distr, target, lower, upper, thresh, ncores));
     return rcpp_result_gen;
 END_RCPP
 }
@@ -462,6 +544,20 @@ BEGIN_RCPP
     return rcpp_result_gen;
 END_RCPP
 }
+// match_plans
+List match_plans(IntegerMatrix plans, IntegerVector ref, NumericVector pop, int ncores);
+RcppExport SEXP _redist_match_plans(SEXP plansSEXP, SEXP refSEXP, SEXP popSEXP, SEXP ncoresSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< IntegerMatrix >::type plans(plansSEXP);
+    Rcpp::traits::input_parameter< IntegerVector >::type ref(refSEXP);
+    Rcpp::traits::input_parameter< NumericVector >::type pop(popSEXP);
+    Rcpp::traits::input_parameter< int >::type ncores(ncoresSEXP);
+    rcpp_result_gen = Rcpp::wrap(match_plans(plans, ref, pop, ncores));
+    return rcpp_result_gen;
+END_RCPP
+}
 // rsg
 List rsg(List adj_list, NumericVector population, int Ndistrict, double target_pop, double thresh, int maxiter);
 RcppExport SEXP _redist_rsg(SEXP adj_listSEXP, SEXP populationSEXP, SEXP NdistrictSEXP, SEXP target_popSEXP, SEXP threshSEXP, SEXP maxiterSEXP) {
@@ -502,6 +598,38 @@ BEGIN_RCPP
     return rcpp_result_gen;
 END_RCPP
 }
+// ms_shortburst
+Rcpp::List ms_shortburst(List l, const arma::uvec& init, const arma::uvec& counties, const arma::uvec& pop, int n_distr, double target, double lower, double upper, double rho, List constraints, int k, List scorer, RObject score_fn, const arma::vec& rescale, const arma::vec& stop_at, const IntegerVector& burst_sizes, int thin, int n_starts, int share_every, int ncores, CharacterVector improve_ch, int verbosity);
+RcppExport SEXP _redist_ms_shortburst(SEXP lSEXP, SEXP initSEXP, SEXP countiesSEXP, SEXP popSEXP, SEXP n_distrSEXP, SEXP targetSEXP, SEXP lowerSEXP, SEXP upperSEXP, SEXP rhoSEXP, SEXP constraintsSEXP, SEXP kSEXP, SEXP scorerSEXP, SEXP score_fnSEXP, SEXP rescaleSEXP, SEXP stop_atSEXP, SEXP burst_sizesSEXP, SEXP thinSEXP, SEXP n_startsSEXP, SEXP share_everySEXP, SEXP ncoresSEXP, SEXP improve_chSEXP, SEXP verbositySEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< List >::type l(lSEXP);
+    Rcpp::traits::input_parameter< const arma::uvec& >::type init(initSEXP);
+    Rcpp::traits::input_parameter< const arma::uvec& >::type counties(countiesSEXP);
+    Rcpp::traits::input_parameter< const arma::uvec& >::type pop(popSEXP);
+    Rcpp::traits::input_parameter< int >::type n_distr(n_distrSEXP);
+    Rcpp::traits::input_parameter< double >::type target(targetSEXP);
+    Rcpp::traits::input_parameter< double >::type lower(lowerSEXP);
+    Rcpp::traits::input_parameter< double >::type upper(upperSEXP);
+    Rcpp::traits::input_parameter< double >::type rho(rhoSEXP);
+    Rcpp::traits::input_parameter< List >::type constraints(constraintsSEXP);
+    Rcpp::traits::input_parameter< int >::type k(kSEXP);
+    Rcpp::traits::input_parameter< List >::type scorer(scorerSEXP);
+    Rcpp::traits::input_parameter< RObject >::type score_fn(score_fnSEXP);
+    Rcpp::traits::input_parameter< const arma::vec& >::type rescale(rescaleSEXP);
+    Rcpp::traits::input_parameter< const arma::vec& >::type stop_at(stop_atSEXP);
+    Rcpp::traits::input_parameter< const IntegerVector& >::type burst_sizes(burst_sizesSEXP);
+    Rcpp::traits::input_parameter< int >::type thin(thinSEXP);
+    Rcpp::traits::input_parameter< int >::type n_starts(n_startsSEXP);
+    Rcpp::traits::input_parameter< int >::type share_every(share_everySEXP);
+    Rcpp::traits::input_parameter< int >::type ncores(ncoresSEXP);
+    Rcpp::traits::input_parameter< CharacterVector >::type improve_ch(improve_chSEXP);
+    Rcpp::traits::input_parameter< int >::type verbosity(verbositySEXP);
+    rcpp_result_gen = Rcpp::wrap(ms_shortburst(l, init, counties, pop, n_distr, target, lower, upper, rho, constraints, k, scorer, score_fn, rescale, stop_at, burst_sizes, thin, n_starts, share_every, ncores, improve_ch, verbosity));
+    return rcpp_result_gen;
+END_RCPP
+}
 // smc_plans
 List smc_plans(int N, List l, const arma::uvec& counties, const arma::uvec& pop, int n_distr, double target, double lower, double upper, double rho, arma::umat districts, int n_drawn, int n_steps, List constraints, List control, int verbosity);
 RcppExport SEXP _redist_smc_plans(SEXP NSEXP, SEXP lSEXP, SEXP countiesSEXP, SEXP popSEXP, SEXP n_distrSEXP, SEXP targetSEXP, SEXP lowerSEXP, SEXP upperSEXP, SEXP rhoSEXP, SEXP districtsSEXP, SEXP n_drawnSEXP, SEXP n_stepsSEXP, SEXP constraintsSEXP, SEXP controlSEXP, SEXP verbositySEXP) {
@@ -584,6 +712,36 @@ BEGIN_RCPP
     return rcpp_result_gen;
 END_RCPP
 }
+// plan_dist_mat
+arma::mat plan_dist_mat(const IntegerMatrix& m, const arma::vec& pop, std::string measure, int ncores);
+RcppExport SEXP _redist_plan_dist_mat(SEXP mSEXP, SEXP popSEXP, SEXP measureSEXP, SEXP ncoresSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const IntegerMatrix& >::type m(mSEXP);
+    Rcpp::traits::input_parameter< const arma::vec& >::type pop(popSEXP);
+    Rcpp::traits::input_parameter< std::string >::type measure(measureSEXP);
+    Rcpp::traits::input_parameter< int >::type ncores(ncoresSEXP);
+    rcpp_result_gen = Rcpp::wrap(plan_dist_mat(m, pop, measure, ncores));
+    return rcpp_result_gen;
+END_RCPP
+}
+// plan_dist_pairs
+NumericVector plan_dist_pairs(const IntegerMatrix& m, const arma::uvec& i, const arma::uvec& j, const arma::vec& pop, std::string measure, int ncores);
+RcppExport SEXP _redist_plan_dist_pairs(SEXP mSEXP, SEXP iSEXP, SEXP jSEXP, SEXP popSEXP, SEXP measureSEXP, SEXP ncoresSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const IntegerMatrix& >::type m(mSEXP);
+    Rcpp::traits::input_parameter< const arma::uvec& >::type i(iSEXP);
+    Rcpp::traits::input_parameter< const arma::uvec& >::type j(jSEXP);
+    Rcpp::traits::input_parameter< const arma::vec& >::type pop(popSEXP);
+    Rcpp::traits::input_parameter< std::string >::type measure(measureSEXP);
+    Rcpp::traits::input_parameter< int >::type ncores(ncoresSEXP);
+    rcpp_result_gen = Rcpp::wrap(plan_dist_pairs(m, i, j, pop, measure, ncores));
+    return rcpp_result_gen;
+END_RCPP
+}
 // var_info_vec
 NumericVector var_info_vec(IntegerMatrix m, IntegerVector ref, NumericVector pop);
 RcppExport SEXP _redist_var_info_vec(SEXP mSEXP, SEXP refSEXP, SEXP popSEXP) {
@@ -619,7 +777,7 @@ static const R_CallMethodDef CallEntries[] = {
     {"_redist_coarsen_adjacency", (DL_FUNC) &_redist_coarsen_adjacency, 2},
     {"_redist_get_plan_graph", (DL_FUNC) &_redist_get_plan_graph, 4},
     {"_redist_color_graph", (DL_FUNC) &_redist_color_graph, 2},
-    {"_redist_polsbypopper", (DL_FUNC) &_redist_polsbypopper, 6},
+    {"_redist_polsbypopper", (DL_FUNC) &_redist_polsbypopper, 7},
     {"_redist_genAlConn", (DL_FUNC) &_redist_genAlConn, 2},
     {"_redist_findBoundary", (DL_FUNC) &_redist_findBoundary, 2},
     {"_redist_contiguity", (DL_FUNC) &_redist_contiguity, 2},
@@ -635,10 +793,14 @@ static const R_CallMethodDef CallEntries[] = {
     {"_redist_colmax", (DL_FUNC) &_redist_colmax, 1},
     {"_redist_colmin", (DL_FUNC) &_redist_colmin, 1},
     {"_redist_prec_cooccur", (DL_FUNC) &_redist_prec_cooccur, 3},
+    {"_redist_prec_cooccur_pairs", (DL_FUNC) &_redist_prec_cooccur_pairs, 5},
     {"_redist_group_pct", (DL_FUNC) &_redist_group_pct, 4},
     {"_redist_pop_tally", (DL_FUNC) &_redist_pop_tally, 3},
     {"_redist_max_dev", (DL_FUNC) &_redist_max_dev, 3},
-    {"_redist_ms_plans", (DL_FUNC) &_redist_ms_plans, 15},
+    {"_redist_ms_plans", (DL_FUNC) &_redist_ms_plans, 17},
+    {"_redist_decode_ms_deltas", (DL_FUNC) &_redist_decode_ms_deltas, 6},
+    {"_redist_ms_tempered", (DL_FUNC) &_redist_ms_tempered, 18},
+    {"_redist_ms_adapt_k", (DL_FUNC) &_redist_ms_adapt_k, 10},
     {"_redist_pareto_dominated", (DL_FUNC) &_redist_pareto_dominated, 1},
     {"_redist_closest_adj_pop", (DL_FUNC) &_redist_closest_adj_pop, 3},
     {"_redist_rint1", (DL_FUNC) &_redist_rint1, 2},
@@ -648,13 +810,17 @@ static const R_CallMethodDef CallEntries[] = {
     {"_redist_plan_joint", (DL_FUNC) &_redist_plan_joint, 3},
     {"_redist_renumber_matrix", (DL_FUNC) &_redist_renumber_matrix, 2},
     {"_redist_solve_hungarian", (DL_FUNC) &_redist_solve_hungarian, 1},
+    {"_redist_match_plans", (DL_FUNC) &_redist_match_plans, 4},
     {"_redist_rsg", (DL_FUNC) &_redist_rsg, 6},
     {"_redist_k_smallest", (DL_FUNC) &_redist_k_smallest, 2},
     {"_redist_k_biggest", (DL_FUNC) &_redist_k_biggest, 2},
+    {"_redist_ms_shortburst", (DL_FUNC) &_redist_ms_shortburst, 22},
     {"_redist_smc_plans", (DL_FUNC) &_redist_smc_plans, 15},
     {"_redist_splits", (DL_FUNC) &_redist_splits, 4},
     {"_redist_dist_cty_splits", (DL_FUNC) &_redist_dist_cty_splits, 3},
     {"_redist_swMH", (DL_FUNC) &_redist_swMH, 20},
+    {"_redist_plan_dist_mat", (DL_FUNC) &_redist_plan_dist_mat, 4},
+    {"_redist_plan_dist_pairs", (DL_FUNC) &_redist_plan_dist_pairs, 6},
     {"_redist_var_info_vec", (DL_FUNC) &_redist_var_info_vec, 3},
     {"_redist_sample_ust", (DL_FUNC) &_redist_sample_ust, 5},
     {NULL, NULL, 0}
@@ -1,4 +1,5 @@
 #include "smc_base.h"
+#include "map_calc.h"
 
 // [[Rcpp::export]]
 NumericMatrix polsbypopper(IntegerVector from,
@@ -6,39 +7,31 @@ NumericMatrix polsbypopper(IntegerVector from,
                            NumericVector area,
                            NumericVector perimeter,
                            IntegerMatrix dm,
-                           int nd) {
-
-    NumericMatrix ret(nd, dm.ncol());
-    NumericVector dist_area(nd);
-    NumericVector dist_peri(nd);
-    NumericVector dist_peri2(nd);
-    NumericVector zerovec(nd);
-    int ne = from.size();
+                           int nd, int ncores = 1) {
+    int V = dm.nrow();
+    int N = dm.ncol();
+    perim_index idx = make_perim_index(as<ivec>(from), as<ivec>(to),
+                                       as<vec>(perimeter), V);
+    umat plans = as<umat>(dm);
+    vec unit_area = as<vec>(area);
     double pi4 = 4.0*3.14159265;
 
-    for(int c = 0; c < dm.ncol(); c++){
-        // update holders:
-        dist_area = clone(zerovec);
-        dist_peri = clone(zerovec);
-
-        // Get a vector of areas ~ just sum
-        for(int r = 0; r < dm.nrow(); r++){
-            dist_area(dm(r,c) - 1) += area(r);
+    // each plan is scored independently, writing only to the memory of `ret`
+    NumericMatrix ret(nd, N);
+    double *ret_mem = ret.begin();
+    RcppThread::ThreadPool pool(ncores > 1 ? ncores : 0);
+    pool.parallelFor(0, N, [&] (int c) {
+        vec dist_area(nd + 1, fill::zeros);
+        for (int r = 0; r < V; r++) {
+            dist_area[plans(r, c)] += unit_area[r];
         }
-        // Get a vector of perims ~ sum by id'ing borders
-        for(int e = 0; e < ne; e++){
-            if(from(e) == -1){
-                dist_peri(dm(to(e) - 1, c) - 1) += perimeter(e);
-            } else {
-                if(dm(from(e) - 1, c) != dm(to(e) - 1, c)){
-                    dist_peri(dm(to(e) - 1, c) - 1) += perimeter(e);
-                }
-            }
+        vec dist_peri = tally_perims(idx, plans.col(c), nd);
+        for (int d = 1; d <= nd; d++) {
+            ret_mem[c * nd + d - 1] = pi4 * dist_area[d] / (dist_peri[d] * dist_peri[d]);
         }
-
-        dist_peri2 = pow(dist_peri, 2.0);
-        ret(_,c) = pi4*dist_area/dist_peri2;
-    }
+    });
+    pool.wait();
+    pool.join();
 
     return ret;
 }
@@ -17,6 +17,8 @@
 
 //#include <iostream>
 #include <vector>
+#include <memory>
+#include <algorithm>
 #include <stdlib.h>
 #include <cfloat> // for DBL_MAX
 #include <cmath>  // for fabs()
@@ -62,7 +64,22 @@ public:
         return cost;
     }
 
+    //********************************************************//
+    // Solve for a cost matrix stored by column, as above, writing one column
+    // per row to `Assignment`. Working memory is kept between calls, so that
+    // one solver can be reused for many problems of the same size.
+    //********************************************************//
+    double SolveColMajor(double *DistMatrix, int nRows, int nCols, int *Assignment){
+        double cost = 0.0;
+        assignmentoptimal(Assignment, &cost, DistMatrix, nRows, nCols);
+        return cost;
+    }
+
 private:
+    // working memory for `assignmentoptimal()`
+    vector<double> distBuf;
+    unique_ptr<bool[]> boolBuf;
+    size_t boolCap = 0;
 
     //********************************************************//
     // Solve optimal solution for assignment problem using Munkres algorithm, also known as Hungarian Algorithm.
@@ -80,7 +97,8 @@ private:
         /* generate working copy of distance Matrix */
         /* check if all matrix elements are positive */
         nOfElements = nOfRows * nOfColumns;
-        distMatrix = (double *)malloc(nOfElements * sizeof(double));
+        distBuf.resize(nOfElements);
+        distMatrix = distBuf.data();
         distMatrixEnd = distMatrix + nOfElements;
 
         for (row = 0; row<nOfElements; row++)
@@ -93,12 +111,18 @@ private:
         }
 
 
-        /* memory allocation */
-        coveredColumns = (bool *)calloc(nOfColumns, sizeof(bool));
-        coveredRows = (bool *)calloc(nOfRows, sizeof(bool));
-        starMatrix = (bool *)calloc(nOfElements, sizeof(bool));
-        primeMatrix = (bool *)calloc(nOfElements, sizeof(bool));
-        newStarMatrix = (bool *)calloc(nOfElements, sizeof(bool)); /* used in step4 */
+        /* memory allocation, reusing earlier calls' */
+        size_t nBool = nOfColumns + nOfRows + 3 * (size_t) nOfElements;
+        if (nBool > boolCap) {
+            boolBuf.reset(new bool[nBool]);
+            boolCap = nBool;
+        }
+        std::fill(boolBuf.get(), boolBuf.get() + nBool, false);
+        coveredColumns = boolBuf.get();
+        coveredRows = coveredColumns + nOfColumns;
+        starMatrix = coveredRows + nOfRows;
+        primeMatrix = starMatrix + nOfElements;
+        newStarMatrix = primeMatrix + nOfElements; /* used in step4 */
 
         /* preliminary steps */
         if (nOfRows <= nOfColumns)
@@ -185,14 +209,6 @@ private:
         /* compute cost and remove invalid assignments */
         computeassignmentcost(assignment, cost, distMatrixIn, nOfRows);
 
-        /* free allocated memory */
-        free(distMatrix);
-        free(coveredColumns);
-        free(coveredRows);
-        free(starMatrix);
-        free(primeMatrix);
-        free(newStarMatrix);
-
         return;
     }
 
@@ -2,6 +2,440 @@
 #include "map_calc.h"
 #include <redistmetrics.h>
 
+/*
+ * Collect the vectors which `constraints` total by district, after `pop`
+ */
+tally_input make_tally_input(List constraints, const uvec &pop) {
+    // the fields of each constraint which are totaled by district
+    const std::vector<std::pair<std::string, std::vector<std::string>>> fields = {
+        {"pop_dev", {}},
+        {"segregation", {"group_pop", "total_pop"}},
+        {"grp_pow", {"group_pop", "total_pop"}},
+        {"grp_hinge", {"group_pop", "total_pop"}},
+        {"grp_inv_hinge", {"group_pop", "total_pop"}},
+        {"compet", {"dvote", "rvote"}},
+        {"polsby", {"area"}},
+        {"qps", {"total_pop"}}
+    };
+
+    tally_input tally;
+    tally.used = false;
+    std::vector<rowvec> rows;
+    rows.push_back(conv_to<rowvec>::from(pop));
+    if (constraints.size() > 0) {
+        for (const auto &f : fields) {
+            if (!constraints.containsElementNamed(f.first.c_str())) continue;
+            tally.used = true;
+            List constr = constraints[f.first];
+            for (int i = 0; i < constr.size(); i++) {
+                List l = constr[i];
+                for (const std::string &field : f.second) {
+                    SEXP x = l[field];
+                    if (tally.rows.count(x)) continue;
+                    tally.rows[x] = rows.size();
+                    if (field == "area") {
+                        rows.push_back(as<rowvec>(x));
+                    } else {
+                        rows.push_back(conv_to<rowvec>::from(as<uvec>(x)));
+                    }
+                }
+            }
+        }
+    }
+
+    // Fryer-Holden with coordinates: the population-weighted sum of squared
+    // distances within a district follows from its totals of p, p*x, p*y,
+    // and p*(x^2 + y^2), which are stored in that order from `rows[l]`
+    if (constraints.size() > 0 && constraints.containsElementNamed("fry_hold")) {
+        List constr = constraints["fry_hold"];
+        for (int i = 0; i < constr.size(); i++) {
+            List l = constr[i];
+            if (!l.containsElementNamed("coords")) continue;
+            tally.used = true;
+            rowvec p = conv_to<rowvec>::from(as<uvec>(l["total_pop"]));
+            mat coords = as<mat>(l["coords"]);
+            // centering limits the cancellation in `eval_fry_hold()`
+            vec cx = coords.col(0);
+            vec cy = coords.col(1);
+            rowvec x = (cx - mean(cx)).t();
+            rowvec y = (cy - mean(cy)).t();
+            tally.rows[l] = rows.size();
+            rows.push_back(p);
+            rows.push_back(rowvec(p % x));
+            rows.push_back(rowvec(p % y));
+            rows.push_back(rowvec(p % (x % x + y % y)));
+        }
+    }
+
+    int V = pop.n_elem;
+    tally.x = mat(rows.size(), V);
+    for (int r = 0; r < (int) rows.size(); r++) {
+        tally.x.row(r) = rows[r];
+    }
+    tally.total = sum(tally.x, 1);
+
+    const std::vector<std::string> split_names = {"splits", "multisplits", "total_splits"};
+    if (constraints.size() > 0) {
+        for (const std::string &name : split_names) {
+            if (!constraints.containsElementNamed(name.c_str())) continue;
+            List constr = constraints[name];
+            for (int i = 0; i < constr.size(); i++) {
+                List l = constr[i];
+                SEXP admin = l["admin"];
+                if (tally.admin_idx.count(admin)) continue;
+                tally.admin_idx[admin] = tally.admin.size();
+                tally.admin.push_back(as<uvec>(admin));
+                tally.n_admin.push_back(as<int>(l["n"]));
+            }
+        }
+    }
+
+    if (constraints.size() > 0 && constraints.containsElementNamed("polsby")) {
+        List constr = constraints["polsby"];
+        for (int i = 0; i < constr.size(); i++) {
+            List l = constr[i];
+            tally.perim_idx[l] = tally.perim.size();
+            tally.perim.push_back(make_perim_index(as<ivec>(l["from"]), as<ivec>(l["to"]),
+                                                   as<vec>(l["perimeter"]), V));
+        }
+    }
+
+    if (constraints.size() > 0 && constraints.containsElementNamed("qps")) {
+        List constr = constraints["qps"];
+        for (int i = 0; i < constr.size(); i++) {
+            List l = constr[i];
+            tally.city_idx[l] = tally.city.size();
+            tally.city.push_back(make_city_index(as<uvec>(l["cities"]), as<uvec>(l["total_pop"]),
+                                                 as<int>(l["n_city"])));
+        }
+    }
+
+    if (constraints.size() > 0 && constraints.containsElementNamed("status_quo")) {
+        List constr = constraints["status_quo"];
+        for (int i = 0; i < constr.size(); i++) {
+            List l = constr[i];
+            tally.city_idx[l] = tally.city.size();
+            tally.city.push_back(make_city_index(as<uvec>(l["current"]), pop,
+                                                 as<int>(l["n_current"])));
+        }
+    }
+
+    return tally;
+}
+
+/*
+ * Build the city index of the units with city `cities` (0 for none)
+ */
+city_index make_city_index(const uvec &cities, const uvec &pop, int n_city) {
+    int V = cities.n_elem;
+    if (pop.n_elem != cities.n_elem)
+        throw std::range_error("Cities and population must have the same length.");
+    city_index idx;
+    idx.ptr.assign(n_city + 1, 0);
+    for (int i = 0; i < V; i++) {
+        if (cities[i] > (uword) n_city)
+            throw std::range_error("City indices must be in range.");
+        if (cities[i] > 0) idx.ptr[cities[i]]++;
+    }
+    for (int c = 0; c < n_city; c++) {
+        idx.ptr[c + 1] += idx.ptr[c];
+    }
+
+    idx.unit.resize(idx.ptr[n_city]);
+    idx.pop.resize(idx.ptr[n_city]);
+    idx.total = vec(n_city, fill::zeros);
+    std::vector<int> pos(idx.ptr.begin(), idx.ptr.end() - 1);
+    for (int i = 0; i < V; i++) {
+        if (cities[i] == 0) continue;
+        int j = pos[cities[i] - 1]++;
+        idx.unit[j] = i;
+        idx.pop[j] = pop[i];
+        idx.total[cities[i] - 1] += pop[i];
+    }
+
+    return idx;
+}
+
+/*
+ * Total the population of each city (row) in each district (column) of
+ * `districts`, with column 0 for units which are not yet assigned
+ */
+mat tally_cities(const city_index &idx, const subview_col<uword> &districts,
+                 int n_distr) {
+    int n_city = idx.ptr.size() - 1;
+    mat city_pop(n_city, n_distr + 1, fill::zeros);
+    for (int c = 0; c < n_city; c++) {
+        for (int j = idx.ptr[c]; j < idx.ptr[c + 1]; j++) {
+            city_pop(c, districts[idx.unit[j]]) += idx.pop[j];
+        }
+    }
+    return city_pop;
+}
+
+/*
+ * Update `city_pop` for a change in `districts` which only moved units between
+ * `distr_1` and `distr_2`
+ */
+void retally_cities(mat &city_pop, const city_index &idx,
+                    const subview_col<uword> &districts, int distr_1, int distr_2) {
+    int n_city = idx.ptr.size() - 1;
+    city_pop.col(distr_1).zeros();
+    city_pop.col(distr_2).zeros();
+    for (int c = 0; c < n_city; c++) {
+        for (int j = idx.ptr[c]; j < idx.ptr[c + 1]; j++) {
+            int distr = districts[idx.unit[j]];
+            if (distr == distr_1 || distr == distr_2) city_pop(c, distr) += idx.pop[j];
+        }
+    }
+}
+
+/*
+ * Build the boundary index of `V` units from the edge list produced by
+ * `redistmetrics::prep_perims()`
+ */
+perim_index make_perim_index(const ivec &from, const ivec &to, const vec &perimeter,
+                             int V) {
+    int n_edge = to.n_elem;
+    perim_index idx;
+    idx.ptr.assign(V + 1, 0);
+    idx.exterior.assign(V, 0.0);
+    for (int e = 0; e < n_edge; e++) {
+        if (from[e] == -1) {
+            idx.exterior[to[e] - 1] += perimeter[e];
+        } else {
+            idx.ptr[to[e]]++;
+        }
+    }
+    for (int i = 0; i < V; i++) {
+        idx.ptr[i + 1] += idx.ptr[i];
+    }
+
+    int n_int = idx.ptr[V];
+    idx.nbr.resize(n_int);
+    idx.len.resize(n_int);
+    std::vector<int> pos(idx.ptr.begin(), idx.ptr.end() - 1);
+    for (int e = 0; e < n_edge; e++) {
+        if (from[e] == -1) continue;
+        int j = pos[to[e] - 1]++;
+        idx.nbr[j] = from[e] - 1;
+        idx.len[j] = perimeter[e];
+    }
+
+    return idx;
+}
+
+/*
+ * Compute the perimeter of every district of `districts`, indexed by district
+ * with 0 for units which are not yet assigned
+ */
+vec tally_perims(const perim_index &idx, const subview_col<uword> &districts,
+                 int n_distr) {
+    int V = districts.n_elem;
+    vec perim(n_distr + 1, fill::zeros);
+    for (int i = 0; i < V; i++) {
+        int distr = districts[i];
+        double p = idx.exterior[i];
+        for (int j = idx.ptr[i]; j < idx.ptr[i + 1]; j++) {
+            if ((int) districts[idx.nbr[j]] != distr) p += idx.len[j];
+        }
+        perim[distr] += p;
+    }
+    return perim;
+}
+
+/*
+ * Update `perim` for a change in `districts` which only moved units between
+ * `distr_1` and `distr_2`
+ */
+void retally_perims(vec &perim, const perim_index &idx,
+                    const subview_col<uword> &districts, int distr_1, int distr_2) {
+    int V = districts.n_elem;
+    perim[distr_1] = 0.0;
+    perim[distr_2] = 0.0;
+    for (int i = 0; i < V; i++) {
+        int distr = districts[i];
+        if (distr != distr_1 && distr != distr_2) continue;
+        double p = idx.exterior[i];
+        for (int j = idx.ptr[i]; j < idx.ptr[i + 1]; j++) {
+            if ((int) districts[idx.nbr[j]] != distr) p += idx.len[j];
+        }
+        perim[distr] += p;
+    }
+}
+
+/*
+ * Compute the district totals and county incidence of `districts`
+ */
+district_tally tally_plan(const subview_col<uword> &districts,
+                          const tally_input &tally, int n_distr) {
+    district_tally dt;
+    if (tally.used) dt.sums = tally_districts(districts, tally.x, n_distr);
+    int n_admin = tally.admin.size();
+    dt.cty.resize(n_admin);
+    for (int j = 0; j < n_admin; j++) {
+        tally_counties(dt.cty[j], districts, tally.admin[j], tally.n_admin[j], n_distr);
+    }
+    for (const perim_index &idx : tally.perim) {
+        dt.perim.push_back(tally_perims(idx, districts, n_distr));
+    }
+    for (const city_index &idx : tally.city) {
+        dt.city.push_back(tally_cities(idx, districts, n_distr));
+    }
+    return dt;
+}
+
+/*
+ * Update `dt` for a change in `districts` which only moved units between
+ * `distr_1` and `distr_2`
+ */
+void retally_plan(district_tally &dt, const subview_col<uword> &districts,
+                  const tally_input &tally, int distr_1, int distr_2) {
+    if (tally.used) {
+        int V = districts.n_elem;
+        int n_row = tally.x.n_rows;
+        dt.sums.col(distr_1).zeros();
+        dt.sums.col(distr_2).zeros();
+        const double *x_i = tally.x.memptr();
+        double *sums_mem = dt.sums.memptr();
+        for (int i = 0; i < V; i++, x_i += n_row) {
+            int distr = districts[i];
+            if (distr != distr_1 && distr != distr_2) continue;
+            double *sums_d = sums_mem + n_row * distr;
+            for (int r = 0; r < n_row; r++) {
+                sums_d[r] += x_i[r];
+            }
+        }
+    }
+    int n_admin = tally.admin.size();
+    for (int j = 0; j < n_admin; j++) {
+        retally_counties(dt.cty[j], districts, tally.admin[j], distr_1, distr_2);
+    }
+    int n_perim = tally.perim.size();
+    for (int j = 0; j < n_perim; j++) {
+        retally_perims(dt.perim[j], tally.perim[j], districts, distr_1, distr_2);
+    }
+    int n_city = tally.city.size();
+    for (int j = 0; j < n_city; j++) {
+        retally_cities(dt.city[j], tally.city[j], districts, distr_1, distr_2);
+    }
+}
+
+/*
+ * Count the units of each county in each district of `districts`, reusing
+ * the memory of `inc` if it has the right size
+ */
+void tally_counties(cty_incidence &inc, const subview_col<uword> &districts,
+                    const uvec &counties, int n_cty, int n_distr) {
+    int V = districts.n_elem;
+    inc.count.zeros(n_cty, n_distr + 1);
+    inc.n_distr.zeros(n_cty);
+    for (int i = 0; i < V; i++) {
+        inc.count(counties[i] - 1, districts[i])++;
+    }
+    for (int d = 1; d <= n_distr; d++) {
+        for (int j = 0; j < n_cty; j++) {
+            if (inc.count(j, d) > 0) inc.n_distr[j]++;
+        }
+    }
+}
+
+/*
+ * Update `inc` for a change in `districts` which only moved units between
+ * `distr_1` and `distr_2`
+ */
+void retally_counties(cty_incidence &inc, const subview_col<uword> &districts,
+                      const uvec &counties, int distr_1, int distr_2) {
+    int V = districts.n_elem;
+    int n_cty = inc.count.n_rows;
+    for (int d : {distr_1, distr_2}) {
+        for (int j = 0; j < n_cty; j++) {
+            if (d != 0 && inc.count(j, d) > 0) inc.n_distr[j]--;
+            inc.count(j, d) = 0;
+        }
+    }
+    for (int i = 0; i < V; i++) {
+        int distr = districts[i];
+        if (distr != distr_1 && distr != distr_2) continue;
+        if (inc.count(counties[i] - 1, distr)++ == 0 && distr != 0) {
+            inc.n_distr[counties[i] - 1]++;
+        }
+    }
+}
+
+/*
+ * Total each row of `x` over the units in every district of `districts`.
+ * Column `d` of the result holds district `d`, and column 0 holds units
+ * which are not yet assigned.
+ */
+mat tally_districts(const subview_col<uword> &districts, const mat &x, int n_distr) {
+    int V = districts.n_elem;
+    int n_row = x.n_rows;
+    mat sums(n_row, n_distr + 1, fill::zeros);
+
+    // both `x` and `sums` store each unit's or district's values
+    // contiguously, so the inner loop vectorizes
+    const double *x_i = x.memptr();
+    double *sums_mem = sums.memptr();
+    for (int i = 0; i < V; i++, x_i += n_row) {
+        double *sums_d = sums_mem + n_row * districts[i];
+        for (int r = 0; r < n_row; r++) {
+            sums_d[r] += x_i[r];
+        }
+    }
+
+    return sums;
+}
+
+/*
+ * The row of `tally` holding the vector `field` of constraint `l`
+ */
+int tally_row(const tally_input &tally, List l, const char *field) {
+    SEXP x = l[field];
+    return tally.rows.at(x);
+}
+
+/*
+ * The first row of `tally` computed from constraint `l` as a whole
+ */
+int tally_row(const tally_input &tally, List l) {
+    return tally.rows.at(l);
+}
+
+/*
+ * The index in `tally.admin` of the counties of split constraint `l`
+ */
+int tally_admin(const tally_input &tally, List l) {
+    SEXP admin = l["admin"];
+    return tally.admin_idx.at(admin);
+}
+
+/*
+ * The index in `tally.perim` of the boundary of Polsby-Popper constraint `l`
+ */
+int tally_perim(const tally_input &tally, List l) {
+    return tally.perim_idx.at(l);
+}
+
+/*
+ * The index in `tally.city` of the cities of QPS constraint `l`
+ */
+int tally_city(const tally_input &tally, List l) {
+    return tally.city_idx.at(l);
+}
+
+// helper function
+// total of `x` over the units in district `distr`, without allocating
+template <typename T>
+static double distr_total(const subview_col<uword> &districts, int distr,
+                          const T &x) {
+    int V = districts.n_elem;
+    double total = 0;
+    for (int i = 0; i < V; i++) {
+        if (districts[i] == distr) total += x[i];
+    }
+    return total;
+}
+
 /*
  * Compute the logarithm of the graph theoretic length of the boundary between
  * `distr_root` and `distr_other`, where the root of `ust` is in `distr_root`
@@ -30,18 +464,23 @@ double log_boundary(const Graph &g, const subview_col<uword> &districts,
  */
 double eval_sq_entropy(const subview_col<uword> &districts, const uvec &current,
                        int distr, const uvec &pop, int n_distr, int n_current, int V) {
-    double accuml = 0;
-    for (int j = 1; j <= n_current; j++) { // 1-indexed districts
-        double pop_overlap = 0;
-        double pop_total = 0;
-        for (int k = 0; k < V; k++) {
-            if (current[k] != j) continue;
-            pop_total += pop[k];
+    city_index idx = make_city_index(current, pop, n_current);
+    int n_plan = std::max((int) max(districts), distr);
+    return eval_sq_entropy(tally_cities(idx, districts, n_plan), idx.total, distr,
+                           n_distr, n_current);
+}
 
-            if (districts[k] == distr)
-                pop_overlap += pop[k];
-        }
-        double frac = pop_overlap / pop_total;
+/*
+ * Compute the status quo penalty for district `distr` from the population of
+ * each current district (row) in each new district (column) of `overlap`,
+ * and the populations of the current districts
+ */
+double eval_sq_entropy(const mat &overlap, const vec &current_pop, int distr,
+                       int n_distr, int n_current) {
+    const double *pop_overlap = overlap.colptr(distr);
+    double accuml = 0;
+    for (int j = 0; j < n_current; j++) {
+        double frac = pop_overlap[j] / current_pop[j];
         if (frac > 0)
             accuml += frac * std::log(frac);
     }
@@ -54,8 +493,15 @@ double eval_sq_entropy(const subview_col<uword> &districts, const uvec &current,
  */
 double eval_grp_hinge(const subview_col<uword> &districts, int distr,
                       const vec &tgts_grp, const uvec &grp_pop, const uvec &total_pop) {
-    uvec idxs = find(districts == distr);
-    double frac = ((double) sum(grp_pop(idxs))) / sum(total_pop(idxs));
+    return eval_grp_hinge(distr_total(districts, distr, grp_pop),
+                          distr_total(districts, distr, total_pop), tgts_grp);
+}
+
+/*
+ * Compute the new, hinge group penalty from a district's totals
+ */
+double eval_grp_hinge(double grp, double total, const vec &tgts_grp) {
+    double frac = grp / total;
     // figure out which to compare it to
     double target;
     double diff = 1;
@@ -76,8 +522,15 @@ double eval_grp_hinge(const subview_col<uword> &districts, int distr,
  */
 double eval_grp_inv_hinge(const subview_col<uword> &districts, int distr,
                       const vec &tgts_grp, const uvec &grp_pop, const uvec &total_pop) {
-    uvec idxs = find(districts == distr);
-    double frac = ((double) sum(grp_pop(idxs))) / sum(total_pop(idxs));
+    return eval_grp_inv_hinge(distr_total(districts, distr, grp_pop),
+                              distr_total(districts, distr, total_pop), tgts_grp);
+}
+
+/*
+ * Compute the new, inverse hinge group penalty from a district's totals
+ */
+double eval_grp_inv_hinge(double grp, double total, const vec &tgts_grp) {
+    double frac = grp / total;
     // figure out which to compare it to
     double target;
     double diff = 1;
@@ -99,8 +552,17 @@ double eval_grp_inv_hinge(const subview_col<uword> &districts, int distr,
 double eval_grp_pow(const subview_col<uword> &districts, int distr,
                    const uvec &grp_pop, const uvec &total_pop,
                    double tgt_grp, double tgt_other, double pow) {
-    uvec idxs = find(districts == distr);
-    double frac = ((double) sum(grp_pop(idxs))) / sum(total_pop(idxs));
+    return eval_grp_pow(distr_total(districts, distr, grp_pop),
+                        distr_total(districts, distr, total_pop),
+                        tgt_grp, tgt_other, pow);
+}
+
+/*
+ * Compute the power-based group penalty from a district's totals
+ */
+double eval_grp_pow(double grp, double total, double tgt_grp, double tgt_other,
+                    double pow) {
+    double frac = grp / total;
     return std::pow(std::fabs(frac - tgt_grp) * std::fabs(frac - tgt_other), pow);
 }
 
@@ -123,41 +585,33 @@ double eval_inc(const subview_col<uword> &districts, int distr, const uvec &incu
 }
 
 
-// helper function
-// calculates districts which appear in each county (but not zeros)
-std::vector<std::set<int>> calc_county_dist(const subview_col<uword> &districts,
-                                            const uvec &counties, int n_cty) {
-    std::vector<std::set<int>> county_dist(n_cty);
-    int V = counties.size();
-    for (int i = 0; i < n_cty; i++) {
-        county_dist[i] = std::set<int>();
-    }
-    for (int i = 0; i < V; i++) {
-        if (districts[i] > 0) {
-            county_dist[counties[i]-1].insert(districts[i]);
-        }
-    }
-    return county_dist;
-}
-
 /*
  * Compute the county split penalty for district `distr`
  */
 double eval_splits(const subview_col<uword> &districts, int distr,
                    const uvec &counties, int n_cty, bool smc) {
-    std::vector<std::set<int>> county_dist = calc_county_dist(districts, counties, n_cty);
+    cty_incidence inc;
+    tally_counties(inc, districts, counties, n_cty, std::max((int) max(districts), distr));
+    return eval_splits(inc, distr, smc);
+}
 
-    int splits = 0;
+/*
+ * Compute the county split penalty for district `distr` from the county
+ * incidence of its plan
+ */
+double eval_splits(const cty_incidence &inc, int distr, bool smc) {
+    if (distr == 0) return 0; // unassigned units are never counted
+    int n_cty = inc.count.n_rows;
+    const uword *count = inc.count.colptr(distr);
+
+    double splits = 0;
     for (int i = 0; i < n_cty; i++) {
-        int cty_n_distr = county_dist[i].size();
+        int cty_n_distr = inc.n_distr[i];
         // for SMC, just count the split when it crosses the threshold
         // for MCMC there is no sequential nature, & the overcount will cancel
         bool cond = smc ? cty_n_distr == 2 : cty_n_distr >= 2;
-        if (cond) {
-            auto search = county_dist[i].find(distr);
-            if (search != county_dist[i].end()) {
-                splits += smc ? 1.0 : 1.0 / cty_n_distr; // take care of MCMC overcount
-            }
+        if (cond && count[i] > 0) {
+            splits += smc ? 1.0 : 1.0 / cty_n_distr; // take care of MCMC overcount
         }
     }
 
@@ -169,19 +623,28 @@ double eval_splits(const subview_col<uword> &districts, int distr,
  */
 double eval_multisplits(const subview_col<uword> &districts, int distr,
                         const uvec &counties, int n_cty, bool smc) {
-    std::vector<std::set<int>> county_dist = calc_county_dist(districts, counties, n_cty);
+    cty_incidence inc;
+    tally_counties(inc, districts, counties, n_cty, std::max((int) max(districts), distr));
+    return eval_multisplits(inc, distr, smc);
+}
+
+/*
+ * Compute the county multisplit penalty for district `distr` from the county
+ * incidence of its plan
+ */
+double eval_multisplits(const cty_incidence &inc, int distr, bool smc) {
+    if (distr == 0) return 0;
+    int n_cty = inc.count.n_rows;
+    const uword *count = inc.count.colptr(distr);
 
     double splits = 0;
     for (int i = 0; i < n_cty; i++) {
-        int cty_n_distr = county_dist[i].size();
+        int cty_n_distr = inc.n_distr[i];
         // for SMC, just count the split when it crosses the threshold
         // for MCMC there is no sequential nature, & the overcount will cancel
         bool cond = smc ? cty_n_distr == 3 : cty_n_distr >= 3;
-        if (cond) {
-            auto search = county_dist[i].find(distr);
-            if (search != county_dist[i].end()) {
-                splits += smc ? 1.0 : 1.0 / cty_n_distr; // take care of MCMC overcount
-            }
+        if (cond && count[i] > 0) {
+            splits += smc ? 1.0 : 1.0 / cty_n_distr; // take care of MCMC overcount
         }
     }
 
@@ -193,17 +656,25 @@ double eval_multisplits(const subview_col<uword> &districts, int distr,
  */
 double eval_total_splits(const subview_col<uword> &districts, int distr,
                          const uvec &counties, int n_cty) {
-    std::vector<std::set<int>> county_dist = calc_county_dist(districts, counties, n_cty);
+    cty_incidence inc;
+    tally_counties(inc, districts, counties, n_cty, std::max((int) max(districts), distr));
+    return eval_total_splits(inc, distr);
+}
+
+/*
+ * Compute the total splits penalty for district `distr` from the county
+ * incidence of its plan
+ */
+double eval_total_splits(const cty_incidence &inc, int distr) {
+    if (distr == 0) return 0;
+    int n_cty = inc.count.n_rows;
+    const uword *count = inc.count.colptr(distr);
 
     double splits = 0;
     for (int i = 0; i < n_cty; i++) {
-        int cty_n_distr = county_dist[i].size();
         // no over-counting since every split counts
-        if (cty_n_distr > 1) {
-            auto search = county_dist[i].find(distr);
-            if (search != county_dist[i].end()) {
-                splits += 1.0;
-            }
+        if (inc.n_distr[i] > 1 && count[i] > 0) {
+            splits += 1.0;
         }
     }
 
@@ -218,54 +689,73 @@ double eval_polsby(const subview_col<uword> &districts, int distr,
                    const ivec &to,
                    const vec &area,
                    const vec &perimeter) {
-    uvec idxs = find(districts == distr);
-
-    double pi4 = 4.0 * 3.14159265;
-    double tot_area = sum(area(idxs));
-
-    double tot_perim = 0.0;
-
-    uvec idx = find(to == distr);
-    for (int e = 0; e < idx.size(); e++) {
-        if(from(idx(e)) == -1) {
-            tot_perim += perimeter(idx(e));
-        } else {
-            if (districts(from(idx(e))) != distr) {
-                tot_perim += perimeter(idx(e));
-            }
+    int V = districts.n_elem;
+    perim_index idx = make_perim_index(from, to, perimeter, V);
+    double perim = 0.0;
+    for (int i = 0; i < V; i++) {
+        if ((int) districts[i] != distr) continue;
+        perim += idx.exterior[i];
+        for (int j = idx.ptr[i]; j < idx.ptr[i + 1]; j++) {
+            if ((int) districts[idx.nbr[j]] != distr) perim += idx.len[j];
         }
     }
+    return eval_polsby(distr_total(districts, distr, area), perim);
+}
 
-    double dist_peri2 = pow(tot_perim, 2.0);
-    return 1.0 - (pi4 * tot_area / dist_peri2);
+/*
+ * Compute the Polsby Popper penalty from a district's area and perimeter
+ */
+double eval_polsby(double area, double perim) {
+    double pi4 = 4.0 * 3.14159265;
+    return 1.0 - (pi4 * area / (perim * perim));
 }
 
 /*
  * Compute the Fryer-Holden penalty for district `distr`
  */
 double eval_fry_hold(const subview_col<uword> &districts, int distr,
-                     const uvec &total_pop, mat ssdmat, double denominator = 1.0) {
+                     const uvec &total_pop, const mat &ssdmat, double denominator) {
     uvec idxs = find(districts == distr);
+    int n = idxs.n_elem;
     double ssd = 0.0;
 
-    for (int i = 0; i < idxs.size() - 1; i++) {
-        for (int k = i + 1; k < idxs.size(); k++) {
-            ssd += (double) ssdmat(idxs(i), idxs(k)) * total_pop(idxs(i)) *
-                total_pop(idxs(k));
+    for (int i = 0; i < n - 1; i++) {
+        // column `idxs(i)` is contiguous, and the matrix is symmetric
+        const double *ssd_i = ssdmat.colptr(idxs(i));
+        double ssd_col = 0.0;
+        for (int k = i + 1; k < n; k++) {
+            ssd_col += ssd_i[idxs(k)] * total_pop(idxs(k));
         }
+        ssd += ssd_col * total_pop(idxs(i));
     }
 
     return ssd / denominator;
 }
 
+/*
+ * Compute the Fryer-Holden penalty from a district's totals of p, p*x, p*y,
+ * and p*(x^2 + y^2), where p is the population and (x, y) the coordinates of
+ * each unit. Equal to the sum over pairs of units of the product of their
+ * populations and their squared distance.
+ */
+double eval_fry_hold(double pop, double sum_x, double sum_y, double sum_sq,
+                     double denominator) {
+    double ssd = pop * sum_sq - sum_x * sum_x - sum_y * sum_y;
+    return std::max(ssd, 0.0) / denominator;
+}
+
 /*
  * Compute the population penalty for district `distr`
  */
 double eval_pop_dev(const subview_col<uword> &districts, int distr,
                        const uvec &total_pop, double parity) {
-    uvec idxs = find(districts == distr);
-    double pop = sum(total_pop(idxs));
+    return eval_pop_dev(distr_total(districts, distr, total_pop), parity);
+}
 
+/*
+ * Compute the population penalty from a district's population
+ */
+double eval_pop_dev(double pop, double parity) {
     return std::pow(pop / parity - 1.0, 2.0);
 }
 
@@ -275,15 +765,20 @@ double eval_pop_dev(const subview_col<uword> &districts, int distr,
  */
 double eval_segregation(const subview_col<uword> &districts, int distr,
                         const uvec &grp_pop, const uvec &total_pop) {
+    return eval_segregation(distr_total(districts, distr, grp_pop),
+                            distr_total(districts, distr, total_pop),
+                            sum(grp_pop), sum(total_pop));
+}
 
-    int T = sum(total_pop);
-    double pAll = (double) sum(grp_pop) / T;
+/*
+ * Compute the segregation penalty from a district's totals and those of the
+ * whole map
+ */
+double eval_segregation(double grp, double pop, double grp_all, double pop_all) {
+    int T = pop_all;
+    double pAll = grp_all / T;
     double denom = (double) 2.0 * T * pAll * (1 - pAll);
 
-    uvec idxs = find(districts == distr);
-    double grp = sum(grp_pop(idxs));
-    double pop = sum(total_pop(idxs));
-
     return (double)(pop * std::abs((grp / pop) - pAll) / denom);
 }
 
@@ -293,29 +788,31 @@ double eval_segregation(const subview_col<uword> &districts, int distr,
 double eval_qps(const subview_col<uword> &districts, int distr,
                 const uvec &total_pop, const uvec &cities, int n_city,
                 int nd) {
+    city_index idx = make_city_index(cities, total_pop, n_city);
+    int n_distr = std::max((int) max(districts), distr);
+    mat city_pop = tally_cities(idx, districts, n_distr);
+    return eval_qps(city_pop, distr, distr_total(districts, distr, total_pop), nd);
+}
 
-    vec tally(n_city);
-    vec pj(n_city);
-    vec j(n_city);
-    vec sumpj(n_city);
-
-    uvec idxs_d = find(districts == distr);
-    double pop = sum(total_pop(idxs_d));
-
-    for (int i = 0; i < n_city; i++){
-        uvec idxs = find(cities == (i + 1));
-        idxs = arma::intersect(idxs_d, idxs);
-        tally(i) = sum(total_pop(idxs));
-        if (tally(i) > 0) {
-            j(i) += 1;
+/*
+ * Compute the qps penalty for district `distr` from the population of each
+ * city in each district, and the population `pop` of the district
+ */
+double eval_qps(const mat &city_pop, int distr, double pop, int nd) {
+    int n_city = city_pop.n_rows;
+    const double *tally = city_pop.colptr(distr);
+
+    double sumpj = 0.0;
+    int n_in = 0; // number of cities in the district
+    for (int i = 0; i < n_city; i++) {
+        if (tally[i] > 0) {
+            double pj = tally[i] / pop;
+            sumpj += pj * (1.0 - pj);
+            n_in++;
         }
     }
 
-    pj = tally / pop;
-    sumpj = pj * (1.0 -  pj);
-    sumpj = sumpj / (double) nd;
-
-    return sum(sumpj) + log(sum(j));
+    return sumpj / (double) nd + log(std::max(n_in, 1));
 }
 
 /*
@@ -336,6 +833,73 @@ double eval_er(const subview_col<uword> &districts, const Graph g, int ndists) {
 
 
 
+/*
+ * Pack the plans (columns of `m`) indexed by `idxs`, which are 1-indexed
+ */
+cooccur_bits pack_cooccur(const umat &m, const uvec &idxs, int ncores) {
+    int V = m.n_rows;
+    int n = idxs.n_elem;
+    cooccur_bits cb;
+    cb.n_plans = n;
+    cb.n_words = (n + 63) / 64;
+    for (int k = 0; k < n; k++) {
+        if (idxs[k] < 1 || idxs[k] > m.n_cols)
+            throw std::range_error("Plan indices must be in range.");
+    }
+    uword max_label = 1;
+    for (int k = 0; k < n; k++) {
+        const uword *col = m.colptr(idxs[k] - 1);
+        for (int i = 0; i < V; i++) {
+            max_label = std::max(max_label, col[i]);
+        }
+    }
+    cb.n_bits = 0;
+    while (max_label > 0) {
+        cb.n_bits++;
+        max_label >>= 1;
+    }
+    cb.bits.assign((size_t) V * cb.n_words * cb.n_bits, 0);
+
+    // each word holds 64 plans, so each task reads whole columns of `m`
+    // and writes only its own words
+    RcppThread::parallelFor(0, cb.n_words, [&] (int w) {
+        int k_end = std::min(n, 64 * (w + 1));
+        for (int k = 64 * w; k < k_end; k++) {
+            uint64_t bit = (uint64_t) 1 << (k - 64 * w);
+            const uword *col = m.colptr(idxs[k] - 1);
+            for (int i = 0; i < V; i++) {
+                uint64_t *word = &cb.bits[((size_t) i * cb.n_words + w) * cb.n_bits];
+                uword label = col[i];
+                for (int b = 0; b < cb.n_bits; b++) {
+                    if ((label >> b) & 1) word[b] |= bit;
+                }
+            }
+        }
+    }, ncores);
+
+    return cb;
+}
+
+/*
+ * Number of the packed plans in words `w_start` to `w_end - 1` which put units
+ * `i` and `j` in the same district, including unused bits of the last word
+ */
+int count_cooccur(const cooccur_bits &cb, int i, int j, int w_start, int w_end) {
+    int nb = cb.n_bits;
+    const uint64_t *x = &cb.bits[((size_t) i * cb.n_words + w_start) * nb];
+    const uint64_t *y = &cb.bits[((size_t) j * cb.n_words + w_start) * nb];
+    int shared = 0;
+    for (int w = w_start; w < w_end; w++, x += nb, y += nb) {
+        // bits set where any bit of the two labels differs
+        uint64_t diff = 0;
+        for (int b = 0; b < nb; b++) {
+            diff |= x[b] ^ y[b];
+        }
+        shared += 64 - (int) std::bitset<64>(diff).count();
+    }
+    return shared;
+}
+
 /*
  * Compute the cooccurence matrix for a set of precincts indexed by `idxs`,
  * given a collection of plans
@@ -344,23 +908,78 @@ mat prec_cooccur(umat m, uvec idxs, int ncores) {
     int v = m.n_rows;
     int n = idxs.n_elem;
     mat out(v, v);
-
-    RcppThread::parallelFor(0, v, [&] (int i) {
-        out(i, i) = 1;
-        for (int j = 0; j < i; j++) {
-            double shared = 0;
-            for (int k = 0; k < n; k++) {
-                shared += m(i, idxs[k]-1) == m(j, idxs[k]-1);
+    cooccur_bits cb = pack_cooccur(m, idxs, ncores);
+    int n_pad = 64 * cb.n_words - n; // unused bits always match
+
+    // tiles of units, with the words of each tile in blocks, so that the
+    // packed labels of both tiles stay in cache
+    const int TILE = 64;
+    const int W_BLOCK = std::max(1, 512 / cb.n_bits);
+    int n_tiles = (v + TILE - 1) / TILE;
+    RcppThread::parallelFor(0, n_tiles, [&] (int ti) {
+        int i_start = ti * TILE;
+        int i_end = std::min(v, i_start + TILE);
+        std::vector<int> shared(TILE * TILE);
+        for (int tj = 0; tj <= ti; tj++) {
+            int j_start = tj * TILE;
+            int j_end = std::min(v, j_start + TILE);
+            std::fill(shared.begin(), shared.end(), 0);
+            for (int w = 0; w < cb.n_words; w += W_BLOCK) {
+                int w_end = std::min(cb.n_words, w + W_BLOCK);
+                for (int i = i_start; i < i_end; i++) {
+                    int j_max = tj == ti ? i : j_end;
+                    int *row = &shared[(i - i_start) * TILE];
+                    for (int j = j_start; j < j_max; j++) {
+                        row[j - j_start] += count_cooccur(cb, i, j, w, w_end);
+                    }
+                }
             }
-            shared /= n;
-            out(i, j) = shared;
-            out(j, i) = shared;
+            for (int i = i_start; i < i_end; i++) {
+                int j_max = tj == ti ? i : j_end;
+                for (int j = j_start; j < j_max; j++) {
+                    double frac = (shared[(i - i_start) * TILE + j - j_start] - n_pad)
+                        / (double) n;
+                    out(i, j) = frac;
+                    out(j, i) = frac;
+                }
+            }
+        }
+        for (int i = i_start; i < i_end; i++) {
+            out(i, i) = 1;
         }
     }, ncores);
 
     return out;
 }
 
+/*
+ * Compute the cooccurence of the pairs of precincts `i` and `j` (1-indexed),
+ * over the plans indexed by `idxs`
+ */
+NumericVector prec_cooccur_pairs(umat m, uvec idxs, uvec i, uvec j, int ncores) {
+    int n_pairs = i.n_elem;
+    int n = idxs.n_elem;
+    if (j.n_elem != i.n_elem)
+        throw std::range_error("Pairs of precincts must have the same length.");
+    if (n == 0)
+        throw std::range_error("Need at least one plan to compute co-occurrence.");
+    for (int p = 0; p < n_pairs; p++) {
+        if (i[p] < 1 || i[p] > m.n_rows || j[p] < 1 || j[p] > m.n_rows)
+            throw std::range_error("Precinct indices must be in range.");
+    }
+    NumericVector out(n_pairs);
+    double *out_mem = out.begin();
+    cooccur_bits cb = pack_cooccur(m, idxs, ncores);
+    int n_pad = 64 * cb.n_words - n;
+
+    RcppThread::parallelFor(0, n_pairs, [&] (int p) {
+        int shared = count_cooccur(cb, i[p] - 1, j[p] - 1, 0, cb.n_words);
+        out_mem[p] = (shared - n_pad) / (double) n;
+    }, ncores);
+
+    return out;
+}
+
 /*
  * Compute the percentage of `group` in each district. Asummes `m` is 1-indexed.
  */
@@ -1,5 +1,8 @@
 #include <algorithm>
 #include <set>
+#include <map>
+#include <bitset>
+#include <cstdint>
 #include <RcppThread.h>
 #include "smc_base.h"
 #include "tree_op.h"
@@ -7,6 +10,178 @@
 #ifndef MAP_CALC_H
 #define MAP_CALC_H
 
+/*
+ * Boundary of each unit, with the interior edges of unit `i` (0-indexed)
+ * stored from `ptr[i]` to `ptr[i+1] - 1` in `nbr` and `len`, and the length of
+ * its boundary with the outside of the map in `exterior`
+ */
+struct perim_index {
+    std::vector<int> ptr;
+    std::vector<int> nbr; // 0-indexed neighbor across each edge
+    std::vector<double> len;
+    std::vector<double> exterior;
+};
+
+/*
+ * Build the boundary index of `V` units from the edge list produced by
+ * `redistmetrics::prep_perims()`. Edge `e` is part of the boundary of unit
+ * `to[e]` and borders unit `from[e]`, or the outside of the map if that is -1.
+ * Units are 1-indexed.
+ */
+perim_index make_perim_index(const ivec &from, const ivec &to, const vec &perimeter,
+                             int V);
+
+/*
+ * Units of each city, with the units of city `c` (1-indexed) stored from
+ * `ptr[c-1]` to `ptr[c] - 1` in `unit` and their populations in `pop`.
+ * Units outside of every city are left out. Also used for the districts of
+ * the current plan in the status quo constraint.
+ */
+struct city_index {
+    std::vector<int> ptr;
+    std::vector<int> unit;
+    std::vector<double> pop;
+    vec total; // population of each city
+};
+
+/*
+ * Build the city index of the units with city `cities` (0 for none)
+ */
+city_index make_city_index(const uvec &cities, const uvec &pop, int n_city);
+
+/*
+ * Unit-level quantities which constraints total by district, stacked as the
+ * rows of `x` with one column per unit, so that every total for a plan comes
+ * from a single pass over its units. Row 0 is the population; `rows` gives
+ * the row of each R vector in the constraints, which may be shared.
+ * The county vectors of split constraints are kept in `admin` in the same way.
+ */
+struct tally_input {
+    mat x;
+    vec total; // totals over all units
+    std::map<SEXP, int> rows;
+    bool used; // whether any constraint needs the district totals
+    std::vector<uvec> admin;
+    std::vector<int> n_admin; // number of counties in each of `admin`
+    std::map<SEXP, int> admin_idx;
+    std::vector<perim_index> perim; // for Polsby-Popper constraints
+    std::map<SEXP, int> perim_idx;
+    std::vector<city_index> city; // for QPS and status quo constraints
+    std::map<SEXP, int> city_idx;
+};
+
+/*
+ * Number of units of each county (row) in each district (column), with
+ * column 0 for units which are not yet assigned
+ */
+struct cty_incidence {
+    umat count;
+    uvec n_distr; // number of districts, other than 0, found in each county
+};
+
+/*
+ * Everything that constraints need to know about the districts of one plan
+ */
+struct district_tally {
+    mat sums; // from `tally_districts()`
+    std::vector<cty_incidence> cty; // one for each of `tally_input::admin`
+    std::vector<vec> perim; // from `tally_perims()`, for each of `tally_input::perim`
+    std::vector<mat> city; // from `tally_cities()`, for each of `tally_input::city`
+};
+
+/*
+ * Collect the vectors which `constraints` total by district, after `pop`
+ */
+tally_input make_tally_input(List constraints, const uvec &pop);
+
+/*
+ * Compute the district totals and county incidence of `districts`
+ */
+district_tally tally_plan(const subview_col<uword> &districts,
+                          const tally_input &tally, int n_distr);
+
+/*
+ * Update `dt` for a change in `districts` which only moved units between
+ * `distr_1` and `distr_2`
+ */
+void retally_plan(district_tally &dt, const subview_col<uword> &districts,
+                  const tally_input &tally, int distr_1, int distr_2);
+
+/*
+ * Count the units of each county in each district of `districts`, reusing
+ * the memory of `inc` if it has the right size
+ */
+void tally_counties(cty_incidence &inc, const subview_col<uword> &districts,
+                    const uvec &counties, int n_cty, int n_distr);
+
+/*
+ * Update `inc` for a change in `districts` which only moved units between
+ * `distr_1` and `distr_2`
+ */
+void retally_counties(cty_incidence &inc, const subview_col<uword> &districts,
+                      const uvec &counties, int distr_1, int distr_2);
+
+/*
+ * Total each row of `x` over the units in every district of `districts`.
+ * Column `d` of the result holds district `d`, and column 0 holds units
+ * which are not yet assigned.
+ */
+mat tally_districts(const subview_col<uword> &districts, const mat &x, int n_distr);
+
+/*
+ * Compute the perimeter of every district of `districts`, indexed by district
+ * with 0 for units which are not yet assigned
+ */
+vec tally_perims(const perim_index &idx, const subview_col<uword> &districts,
+                 int n_distr);
+
+/*
+ * Update `perim` for a change in `districts` which only moved units between
+ * `distr_1` and `distr_2`. Other districts keep all of their boundary edges.
+ */
+void retally_perims(vec &perim, const perim_index &idx,
+                    const subview_col<uword> &districts, int distr_1, int distr_2);
+
+/*
+ * Total the population of each city (row) in each district (column) of
+ * `districts`, with column 0 for units which are not yet assigned
+ */
+mat tally_cities(const city_index &idx, const subview_col<uword> &districts,
+                 int n_distr);
+
+/*
+ * Update `city_pop` for a change in `districts` which only moved units between
+ * `distr_1` and `distr_2`
+ */
+void retally_cities(mat &city_pop, const city_index &idx,
+                    const subview_col<uword> &districts, int distr_1, int distr_2);
+
+/*
+ * The row of `tally` holding the vector `field` of constraint `l`
+ */
+int tally_row(const tally_input &tally, List l, const char *field);
+
+/*
+ * The first row of `tally` computed from constraint `l` as a whole
+ */
+int tally_row(const tally_input &tally, List l);
+
+/*
+ * The index in `tally.admin` of the counties of split constraint `l`
+ */
+int tally_admin(const tally_input &tally, List l);
+
+/*
+ * The index in `tally.perim` of the boundary of Polsby-Popper constraint `l`
+ */
+int tally_perim(const tally_input &tally, List l);
+
+/*
+ * The index in `tally.city` of the cities of QPS constraint `l`, or the
+ * current districts of status quo constraint `l`
+ */
+int tally_city(const tally_input &tally, List l);
+
 /*
  * Compute the logarithm of the graph theoretic length of the boundary between
  * `distr_root` and `distr_other`, where the root of `ust` is in `distr_root`
@@ -19,18 +194,22 @@ double log_boundary(const Graph &g, const subview_col<uword> &districts,
  */
 double eval_sq_entropy(const subview_col<uword> &districts, const uvec &current,
                        int distr, const uvec &pop, int n_distr, int n_current, int V);
+double eval_sq_entropy(const mat &overlap, const vec &current_pop, int distr,
+                       int n_distr, int n_current);
 
 /*
  * Compute the new, hinge VRA penalty for district `distr`
  */
 double eval_grp_hinge(const subview_col<uword> &districts, int distr,
                       const vec &tgts_grp, const uvec &grp_pop, const uvec &total_pop);
+double eval_grp_hinge(double grp, double total, const vec &tgts_grp);
 
 /*
  * Compute the new, hinge VRA penalty for district `distr`
  */
 double eval_grp_inv_hinge(const subview_col<uword> &districts, int distr,
                       const vec &tgts_grp, const uvec &grp_pop, const uvec &total_pop);
+double eval_grp_inv_hinge(double grp, double total, const vec &tgts_grp);
 
 /*
  * Compute the old VRA penalty for district `distr`
@@ -38,6 +217,8 @@ double eval_grp_inv_hinge(const subview_col<uword> &districts, int distr,
 double eval_grp_pow(const subview_col<uword> &districts, int distr,
                     const uvec &grp_pop, const uvec &total_pop,
                     double tgt_grp, double tgt_other, double pow);
+double eval_grp_pow(double grp, double total, double tgt_grp, double tgt_other,
+                    double pow);
 
 /*
  * Compute the incumbent-preserving penalty for district `distr`
@@ -49,18 +230,21 @@ double eval_inc(const subview_col<uword> &districts, int distr, const uvec &incu
  */
 double eval_splits(const subview_col<uword> &districts, int distr,
                    const uvec &counties, int n_cty, bool smc);
+double eval_splits(const cty_incidence &inc, int distr, bool smc);
 
 /*
  * Compute the county fracture penalty for district `distr`
  */
 double eval_multisplits(const subview_col<uword> &districts, int distr,
                         const uvec &counties, int n_cty, bool smc);
+double eval_multisplits(const cty_incidence &inc, int distr, bool smc);
 
 /*
  * Compute the county split penalty for district `distr`
  */
 double eval_total_splits(const subview_col<uword> &districts, int distr,
                    const uvec &counties, int n_cty);
+double eval_total_splits(const cty_incidence &inc, int distr);
 
 /*
  * Compute the Polsby Popper penalty for district `distr`
@@ -70,24 +254,29 @@ double eval_polsby(const subview_col<uword> &districts, int distr,
             const ivec &to,
             const vec &area,
             const vec &perimeter);
+double eval_polsby(double area, double perim);
 
 /*
  * Compute the Fryer-Holden penalty for district `distr`
  */
 double eval_fry_hold(const subview_col<uword> &districts, int distr,
-                     const uvec &total_pop, mat ssdmat, double denominator);
+                     const uvec &total_pop, const mat &ssdmat, double denominator);
+double eval_fry_hold(double pop, double sum_x, double sum_y, double sum_sq,
+                     double denominator);
 
 /*
  * Compute the population penalty for district `distr`
  */
 double eval_pop_dev(const subview_col<uword> &districts, int distr,
                        const uvec &total_pop, double parity);
+double eval_pop_dev(double pop, double parity);
 
 /*
  * Compute the segregation penalty for district `distr`
  */
 double eval_segregation(const subview_col<uword> &districts, int distr,
                         const uvec &grp_pop, const uvec &total_pop);
+double eval_segregation(double grp, double pop, double grp_all, double pop_all);
 
 /*
  * Compute the qps penalty for district `distr`
@@ -95,6 +284,7 @@ double eval_segregation(const subview_col<uword> &districts, int distr,
 double eval_qps(const subview_col<uword> &districts, int distr,
                 const uvec &total_pop, const uvec &cities, int n_city,
                 int nd);
+double eval_qps(const mat &city_pop, int distr, double pop, int nd);
 
 /*
  * Compute the log spanning tree penalty for district `distr`
@@ -109,6 +299,30 @@ double eval_er(const subview_col<uword> &districts, const Graph g, int ndists);
 
 
 
+/*
+ * Labels of a set of plans packed by unit for co-occurrence counts. Bit `b`
+ * of the label of unit `i` in the plans `64*w` to `64*w + 63` is bit `k` of
+ * word `(i * n_words + w) * n_bits + b`, for the `k`-th of those plans. Bits
+ * past the last plan are zero.
+ */
+struct cooccur_bits {
+    int n_plans;
+    int n_words;
+    int n_bits;
+    std::vector<uint64_t> bits;
+};
+
+/*
+ * Pack the plans (columns of `m`) indexed by `idxs`, which are 1-indexed
+ */
+cooccur_bits pack_cooccur(const umat &m, const uvec &idxs, int ncores);
+
+/*
+ * Number of the packed plans in words `w_start` to `w_end - 1` which put units
+ * `i` and `j` in the same district, including unused bits of the last word
+ */
+int count_cooccur(const cooccur_bits &cb, int i, int j, int w_start, int w_end);
+
 /*
  * Compute the cooccurence matrix for a set of precincts indexed by `idxs`,
  * given a collection of plans
@@ -116,6 +330,14 @@ double eval_er(const subview_col<uword> &districts, const Graph g, int ndists);
 // [[Rcpp::export]]
 arma::mat prec_cooccur(arma::umat m, arma::uvec idxs, int ncores=0);
 
+/*
+ * Compute the cooccurence of the pairs of precincts `i` and `j` (1-indexed),
+ * over the plans indexed by `idxs`
+ */
+// [[Rcpp::export]]
+NumericVector prec_cooccur_pairs(arma::umat m, arma::uvec idxs, arma::uvec i,
+                                 arma::uvec j, int ncores=0);
+
 /*
  * Compute the percentage of `group` in each district. Asummes `m` is 1-indexed.
  */
@@ -1,144 +1,268 @@
 #include "mcmc_gibbs.h"
 
 /*
- * Helper function to iterate over constraints and apply them
+ * Names of the constraint types, as used in R, indexed by `constr_type`
  */
-double add_constraint(const std::string& name, List constraints,
-                      std::vector<int> districts, NumericVector &psi_vec,
-                      std::function<double(List, int)> fn_constr) {
-    if (!constraints.containsElementNamed(name.c_str())) return 0;
+static const char *CONSTR_NAMES[N_CONSTR_TYPES] = {
+    "pop_dev", "splits", "multisplits", "total_splits",
+    "segregation", "grp_pow", "grp_hinge", "grp_inv_hinge",
+    "compet", "status_quo", "incumbency",
+    "polsby", "fry_hold", "log_st", "edges_removed",
+    "qps", "custom", "plugin"
+};
 
-    List constr = constraints[name];
-    double val = 0;
-    double psi = 0.0;
-    for (int i = 0; i < constr.size(); i++) {
-        List constr_inst = constr[i];
-        double strength = constr_inst["strength"];
-        if (strength != 0) {
-            for (int dist : districts) {
-                psi = fn_constr(constr_inst, dist);
-                psi_vec[name] = psi + psi_vec[name];
-                val += strength * (psi);
-            }
-        }
+CharacterVector constr_names() {
+    CharacterVector names(N_CONSTR_TYPES);
+    for (int t = 0; t < N_CONSTR_TYPES; t++) {
+        names[t] = CONSTR_NAMES[t];
     }
-    return val;
+    return names;
 }
 
 /*
- * Add specific constraint weights & return the cumulative weight vector
+ * Extract every constraint in `constraints` for a sampler, and call the
+ * `init()` of compiled ones
  */
-double calc_gibbs_tgt(const subview_col<uword> &plan, int n_distr, int V,
-                      std::vector<int> districts, NumericVector &psi_vec, const uvec &pop,
-                      double parity, const Graph &g, List constraints) {
-    if (constraints.size() == 0) return 0.0;
-    double log_tgt = 0;
-    double n_consider = (double) districts.size();
-
-    log_tgt += add_constraint("pop_dev", constraints, districts, psi_vec,
-                              [&] (List l, int distr) -> double {
-                                  return eval_pop_dev(plan, distr,
-                                                      pop, parity);
-                              });
-
-    log_tgt += add_constraint("splits", constraints, districts, psi_vec,
-                              [&] (List l, int distr) -> double {
-                                  return eval_splits(plan, distr, as<uvec>(l["admin"]), l["n"], false);
-                              });
-
-    log_tgt += add_constraint("multisplits", constraints, districts, psi_vec,
-                              [&] (List l, int distr) -> double {
-                                  return eval_multisplits(plan, distr, as<uvec>(l["admin"]), l["n"], false);
-                              });
-
-    log_tgt += add_constraint("total_splits", constraints, districts, psi_vec,
-                              [&] (List l, int distr) -> double {
-                                  return eval_total_splits(plan, distr, as<uvec>(l["admin"]), l["n"]);
-                              });
-
-    log_tgt += add_constraint("segregation", constraints, districts, psi_vec,
-                              [&] (List l, int distr) -> double {
-                                  return eval_segregation(plan, distr, as<uvec>(l["group_pop"]), as<uvec>(l["total_pop"]));
-                              });
-
-    log_tgt += add_constraint("grp_pow", constraints, districts, psi_vec,
-                              [&] (List l, int distr) -> double {
-                                  return eval_grp_pow(plan, distr, as<uvec>(l["group_pop"]),
-                                                      as<uvec>(l["total_pop"]), as<double>(l["tgt_group"]),
-                                                      as<double>(l["tgt_other"]), as<double>(l["pow"]));
-                              });
-
-    log_tgt += add_constraint("grp_hinge", constraints, districts, psi_vec,
-                              [&] (List l, int distr) -> double {
-                                  return eval_grp_hinge(plan, distr, as<vec>(l["tgts_group"]),
-                                                        as<uvec>(l["group_pop"]), as<uvec>(l["total_pop"]));
-                              });
-
-    log_tgt += add_constraint("grp_inv_hinge", constraints, districts, psi_vec,
-                              [&] (List l, int distr) -> double {
-                                  return eval_grp_hinge(plan, distr, as<vec>(l["tgts_group"]),
-                                                            as<uvec>(l["group_pop"]), as<uvec>(l["total_pop"]));
-                              });
-
-    log_tgt += add_constraint("compet", constraints, districts, psi_vec,
-                              [&] (List l, int distr) -> double {
-                                  uvec dvote = l["dvote"];
-                                  uvec total = dvote + as<uvec>(l["rvote"]);
-                                  return eval_grp_pow(plan, distr, dvote, total, 0.5, 0.5,
-                                                      as<double>(l["pow"]));
-                              });
+constr_registry make_constr_registry(List constraints, const uvec &pop, int n_distr,
+                                     double parity, const Graph &g, bool smc) {
+    constr_registry reg;
+    reg.tally = make_tally_input(constraints, pop);
+    reg.n_distr = n_distr;
+    reg.parity = parity;
+    reg.g = &g;
+    reg.smc = smc;
+    if (constraints.size() == 0) return reg;
 
-    log_tgt += add_constraint("status_quo", constraints, districts, psi_vec,
-                              [&] (List l, int distr) -> double {
-                                  return eval_sq_entropy(plan, as<uvec>(l["current"]), distr,
-                                                         pop, n_distr, as<int>(l["n_current"]), V);
-                              });
+    CharacterVector names = constraints.names();
+    for (int i = 0; i < constraints.size(); i++) {
+        std::string name = as<std::string>(names[i]);
+        int type = 0;
+        while (type < N_CONSTR_TYPES && name != CONSTR_NAMES[type]) type++;
+        if (type == N_CONSTR_TYPES) continue;
+        // the spanning tree and edge terms are part of SMC's proposal
+        if (smc && (type == CONSTR_LOG_ST || type == CONSTR_EDGES_REMOVED)) continue;
 
-    log_tgt += add_constraint("incumbency", constraints, districts, psi_vec,
-                              [&] (List l, int distr) -> double {
-                                  return eval_inc(plan, distr, as<uvec>(l["incumbents"]));
-                              });
+        List constr = constraints[i];
+        for (int j = 0; j < constr.size(); j++) {
+            List l = constr[j];
+            constr_term term;
+            term.type = (constr_type) type;
+            term.strength = l["strength"];
+            if (term.strength == 0) continue;
+            term.scope = CONSTR_LOCAL | CONSTR_NATIVE;
 
+            switch (term.type) {
+            case CONSTR_SPLITS:
+            case CONSTR_MULTISPLITS:
+            case CONSTR_TOTAL_SPLITS:
+                // depend on which other districts share a county
+                term.scope = CONSTR_GLOBAL | CONSTR_NATIVE;
+                term.idx = tally_admin(reg.tally, l);
+                break;
+            case CONSTR_SEGREGATION:
+                term.row = tally_row(reg.tally, l, "group_pop");
+                term.row_2 = tally_row(reg.tally, l, "total_pop");
+                break;
+            case CONSTR_GRP_POW:
+                term.row = tally_row(reg.tally, l, "group_pop");
+                term.row_2 = tally_row(reg.tally, l, "total_pop");
+                term.param_1 = l["tgt_group"];
+                term.param_2 = l["tgt_other"];
+                term.param_3 = l["pow"];
+                break;
+            case CONSTR_GRP_HINGE:
+            case CONSTR_GRP_INV_HINGE:
+                term.row = tally_row(reg.tally, l, "group_pop");
+                term.row_2 = tally_row(reg.tally, l, "total_pop");
+                term.tgts = as<vec>(l["tgts_group"]);
+                break;
+            case CONSTR_COMPET:
+                term.row = tally_row(reg.tally, l, "dvote");
+                term.row_2 = tally_row(reg.tally, l, "rvote");
+                term.param_1 = l["pow"];
+                break;
+            case CONSTR_STATUS_QUO:
+                term.idx = tally_city(reg.tally, l);
+                term.param_2 = as<int>(l["n_current"]);
+                break;
+            case CONSTR_INCUMBENCY:
+                term.units = as<uvec>(l["incumbents"]);
+                break;
+            case CONSTR_POLSBY:
+                term.row = tally_row(reg.tally, l, "area");
+                term.idx = tally_perim(reg.tally, l);
+                break;
+            case CONSTR_FRY_HOLD:
+                term.param_1 = l["denominator"];
+                if (l.containsElementNamed("coords")) {
+                    term.row = tally_row(reg.tally, l);
+                } else {
+                    term.ssdmat = as<mat>(l["ssdmat"]);
+                    term.units = as<uvec>(l["total_pop"]);
+                }
+                break;
+            case CONSTR_LOG_ST:
+                term.scope = CONSTR_GLOBAL | CONSTR_NATIVE;
+                term.units = as<uvec>(l["admin"]);
+                break;
+            case CONSTR_EDGES_REMOVED:
+                term.scope = CONSTR_GLOBAL | CONSTR_NATIVE;
+                break;
+            case CONSTR_QPS:
+                term.row = tally_row(reg.tally, l, "total_pop");
+                term.idx = tally_city(reg.tally, l);
+                break;
+            case CONSTR_CUSTOM:
+                term.scope = CONSTR_GLOBAL | CONSTR_R;
+                term.fn = l["fn"];
+                term.batch = l.containsElementNamed("batch") && as<bool>(l["batch"]);
+                break;
+            case CONSTR_PLUGIN: {
+                // treated as global so that samplers use its `delta()`
+                term.scope = CONSTR_GLOBAL | CONSTR_NATIVE;
+                XPtr<redist::constr_plugin> ptr(as<SEXP>(l["ptr"]));
+                redist::constr_plugin *plugin = ptr.checked_get();
+                plugin->init(pop, n_distr);
+                term.plugin = plugin;
+                break;
+            }
+            default:
+                break;
+            }
+            reg.terms.push_back(std::move(term));
+        }
+    }
 
-    log_tgt += add_constraint("polsby", constraints, districts, psi_vec,
-                              [&] (List l, int distr) -> double {
-                                  return eval_polsby(plan, distr, as<ivec>(l["from"]),
-                                                     as<ivec>(l["to"]), as<vec>(l["area"]),
-                                                     as<vec>(l["perimeter"]));
-                              });
-
-    log_tgt += add_constraint("fry_hold", constraints, districts, psi_vec,
-                              [&] (List l, int distr) -> double {
-                                  return eval_fry_hold(plan, distr, as<uvec>(l["total_pop"]),
-                                                       as<mat>(l["ssdmat"]),
-                                                       as<double>(l["denominator"]));
-                              });
-
-    log_tgt += add_constraint("log_st", constraints, districts, psi_vec,
-                              [&] (List l, int distr) -> double {
-                                  return eval_log_st(plan, g,
-                                                     as<uvec>(l["admin"]),
-                                                     n_distr) / n_consider;
-                              });
-
-    log_tgt += add_constraint("edges_removed", constraints, districts, psi_vec,
-                              [&] (List l, int distr) -> double {
-                                  return eval_er(plan, g, n_distr) / n_consider;
-                              });
+    return reg;
+}
 
-    log_tgt += add_constraint("qps", constraints, districts, psi_vec,
-                              [&] (List l, int distr) -> double {
-                                  return eval_qps(plan, distr, as<uvec>(l["total_pop"]),
-                                                  as<uvec>(l["cities"]), as<int>(l["n_city"]),
-                                                  n_distr);
-                              });
+/*
+ * Whether any term of `reg` is evaluated under `scope`
+ */
+bool has_constr(const constr_registry &reg, int scope) {
+    for (const constr_term &term : reg.terms) {
+        if ((term.scope & scope) == term.scope) return true;
+    }
+    return false;
+}
 
-    log_tgt += add_constraint("custom", constraints, districts, psi_vec,
-                              [&] (List l, int distr) -> double {
-                                  Function fn = l["fn"];
-                                  return as<NumericVector>(fn(plan, distr))[0];
-                              });
+/*
+ * Whether any of `constraints` must be evaluated through R
+ */
+bool has_r_constr(List constraints) {
+    return constraints.size() > 0 && constraints.containsElementNamed("custom");
+}
 
+/*
+ * Unweighted value of one constraint for district `distr` of `plan`
+ */
+double eval_constr(const constr_registry &reg, const constr_term &term,
+                   const subview_col<uword> &plan, const district_tally &dt,
+                   int distr, double n_consider) {
+    const mat &sums = dt.sums;
+    switch (term.type) {
+    case CONSTR_POP_DEV:
+        return eval_pop_dev(sums.at(0, distr), reg.parity);
+    case CONSTR_SPLITS:
+        return eval_splits(dt.cty[term.idx], distr, reg.smc);
+    case CONSTR_MULTISPLITS:
+        return eval_multisplits(dt.cty[term.idx], distr, reg.smc);
+    case CONSTR_TOTAL_SPLITS:
+        return eval_total_splits(dt.cty[term.idx], distr);
+    case CONSTR_SEGREGATION:
+        return eval_segregation(sums.at(term.row, distr), sums.at(term.row_2, distr),
+                                reg.tally.total[term.row], reg.tally.total[term.row_2]);
+    case CONSTR_GRP_POW:
+        return eval_grp_pow(sums.at(term.row, distr), sums.at(term.row_2, distr),
+                            term.param_1, term.param_2, term.param_3);
+    case CONSTR_GRP_HINGE:
+        return eval_grp_hinge(sums.at(term.row, distr), sums.at(term.row_2, distr),
+                              term.tgts);
+    case CONSTR_GRP_INV_HINGE:
+        return eval_grp_inv_hinge(sums.at(term.row, distr), sums.at(term.row_2, distr),
+                                  term.tgts);
+    case CONSTR_COMPET: {
+        double dvote = sums.at(term.row, distr);
+        double rvote = sums.at(term.row_2, distr);
+        return eval_grp_pow(dvote, dvote + rvote, 0.5, 0.5, term.param_1);
+    }
+    case CONSTR_STATUS_QUO:
+        return eval_sq_entropy(dt.city[term.idx], reg.tally.city[term.idx].total, distr,
+                               reg.n_distr, (int) term.param_2);
+    case CONSTR_INCUMBENCY:
+        return eval_inc(plan, distr, term.units);
+    case CONSTR_POLSBY:
+        return eval_polsby(sums.at(term.row, distr), dt.perim[term.idx][distr]);
+    case CONSTR_FRY_HOLD:
+        if (term.ssdmat.n_elem == 0) {
+            return eval_fry_hold(sums.at(term.row, distr), sums.at(term.row + 1, distr),
+                                 sums.at(term.row + 2, distr), sums.at(term.row + 3, distr),
+                                 term.param_1);
+        }
+        return eval_fry_hold(plan, distr, term.units, term.ssdmat, term.param_1);
+    case CONSTR_LOG_ST:
+        return eval_log_st(plan, *reg.g, term.units, reg.n_distr) / n_consider;
+    case CONSTR_EDGES_REMOVED:
+        return eval_er(plan, *reg.g, reg.n_distr) / n_consider;
+    case CONSTR_QPS:
+        return eval_qps(dt.city[term.idx], distr, sums.at(term.row, distr), reg.n_distr);
+    case CONSTR_CUSTOM: {
+        Function fn(term.fn);
+        if (term.batch) {
+            // a batched function expects a matrix of plans
+            umat one(plan);
+            return as<NumericVector>(fn(one, distr))[0];
+        }
+        return as<NumericVector>(fn(plan, distr))[0];
+    }
+    case CONSTR_PLUGIN:
+        return term.plugin->eval_district(plan, distr);
+    default:
+        return 0;
+    }
+}
 
+/*
+ * Weighted sum of the constraints of `reg` under `scope` for `districts` of
+ * `plan`
+ */
+double calc_gibbs_tgt(const constr_registry &reg, const subview_col<uword> &plan,
+                      const district_tally &dt, const std::vector<int> &districts,
+                      int scope, vec *psi) {
+    double log_tgt = 0;
+    double n_consider = (double) districts.size();
+    for (const constr_term &term : reg.terms) {
+        if ((term.scope & scope) != term.scope) continue;
+        for (int distr : districts) {
+            double val = eval_constr(reg, term, plan, dt, distr, n_consider);
+            if (psi != nullptr) (*psi)[term.type] += val;
+            log_tgt += term.strength * val;
+        }
+    }
     return log_tgt;
 }
+
+/*
+ * Change in `calc_gibbs_tgt()` for `districts` from `plan` to `new_plan`
+ */
+double calc_gibbs_delta(const constr_registry &reg,
+                        const subview_col<uword> &plan, const district_tally &dt,
+                        const subview_col<uword> &new_plan, const district_tally &new_dt,
+                        const std::vector<int> &districts, int scope) {
+    double delta = 0;
+    double n_consider = (double) districts.size();
+    for (const constr_term &term : reg.terms) {
+        if ((term.scope & scope) != term.scope) continue;
+        for (int distr : districts) {
+            double val;
+            if (term.type == CONSTR_PLUGIN) {
+                val = term.plugin->delta(plan, new_plan, distr);
+            } else {
+                val = eval_constr(reg, term, new_plan, new_dt, distr, n_consider)
+                    - eval_constr(reg, term, plan, dt, distr, n_consider);
+            }
+            delta += term.strength * val;
+        }
+    }
+    return delta;
+}
@@ -5,13 +5,131 @@
 #include "redist_types.h"
 #include "make_swaps_helper.h"
 #include "map_calc.h"
+#include <redist_plugin.h>
 
-double add_constraint(const std::string& name, List constraints,
-                      std::vector<int> districts, NumericVector &psi_vec,
-                      std::function<double(List, int)> fn_constr);
+/*
+ * Every kind of constraint, in the order of `constr_names()`
+ */
+enum constr_type {
+    CONSTR_POP_DEV,
+    CONSTR_SPLITS,
+    CONSTR_MULTISPLITS,
+    CONSTR_TOTAL_SPLITS,
+    CONSTR_SEGREGATION,
+    CONSTR_GRP_POW,
+    CONSTR_GRP_HINGE,
+    CONSTR_GRP_INV_HINGE,
+    CONSTR_COMPET,
+    CONSTR_STATUS_QUO,
+    CONSTR_INCUMBENCY,
+    CONSTR_POLSBY,
+    CONSTR_FRY_HOLD,
+    CONSTR_LOG_ST,
+    CONSTR_EDGES_REMOVED,
+    CONSTR_QPS,
+    CONSTR_CUSTOM,
+    CONSTR_PLUGIN,
+    N_CONSTR_TYPES
+};
 
-double calc_gibbs_tgt(const subview_col<uword> &plan, int n_distr, int V,
-                      std::vector<int> districts, NumericVector &psi_vec, const uvec &pop,
-                      double parity, const Graph &g, List constraints);
+/*
+ * Flags for which constraints to evaluate. A constraint is evaluated when
+ * both of its flags are given: whether its value for a district depends only
+ * on the units assigned to it (`LOCAL`) or not (`GLOBAL`), and whether it is
+ * evaluated in C++ (`NATIVE`), and so may be evaluated from worker threads,
+ * or calls into R (`R`).
+ */
+enum constr_scope {
+    CONSTR_LOCAL = 1,
+    CONSTR_GLOBAL = 2,
+    CONSTR_NATIVE = 4,
+    CONSTR_R = 8,
+    CONSTR_ALL = 15
+};
+
+/*
+ * One constraint, with everything it needs from R extracted
+ */
+struct constr_term {
+    constr_type type;
+    double strength;
+    int scope; // from `constr_scope`
+    int row = 0; // row of the district totals, from `tally_row()`
+    int row_2 = 0; // second row, for constraints on a share
+    int idx = 0; // county, perimeter, or city index, from `tally_*()`
+    double param_1 = 0; // target group share, exponent, or denominator
+    double param_2 = 0; // target other share, or number of current districts
+    double param_3 = 0; // exponent of `grp_pow`
+    vec tgts; // hinge targets
+    uvec units; // incumbents, administrative units, or population
+    mat ssdmat; // squared distances between units, if given
+    RObject fn; // custom constraint function
+    bool batch = false; // whether `fn` takes a matrix of plans
+    const redist::constr_plugin *plugin = nullptr;
+};
+
+/*
+ * Every constraint of a sampler run, with the inputs to `tally_plan()`
+ */
+struct constr_registry {
+    std::vector<constr_term> terms;
+    tally_input tally;
+    int n_distr;
+    double parity;
+    const Graph *g;
+    bool smc; // whether plans may have unassigned units
+};
+
+/*
+ * Names of the constraint types, as used in R, indexed by `constr_type`
+ */
+CharacterVector constr_names();
+
+/*
+ * Extract every constraint in `constraints` for a sampler with `n_distr`
+ * districts of population `parity`, and call the `init()` of compiled ones.
+ * Constraints which the sampler does not use are left out. Must be called from
+ * the main thread.
+ */
+constr_registry make_constr_registry(List constraints, const uvec &pop, int n_distr,
+                                     double parity, const Graph &g, bool smc);
+
+/*
+ * Whether any term of `reg` is evaluated under `scope`
+ */
+bool has_constr(const constr_registry &reg, int scope);
+
+/*
+ * Whether any of `constraints` must be evaluated through R, so that the
+ * sampler cannot evaluate them from worker threads
+ */
+bool has_r_constr(List constraints);
+
+/*
+ * Unweighted value of one constraint for district `distr` of `plan`, whose
+ * totals are `dt`. `n_consider` is the number of districts being evaluated,
+ * over which plan-wide constraints are spread.
+ */
+double eval_constr(const constr_registry &reg, const constr_term &term,
+                   const subview_col<uword> &plan, const district_tally &dt,
+                   int distr, double n_consider);
+
+/*
+ * Weighted sum of the constraints of `reg` under `scope` for `districts` of
+ * `plan`, whose totals are `dt`. The unweighted values are added to `psi`,
+ * indexed by `constr_type`, if it is not null.
+ */
+double calc_gibbs_tgt(const constr_registry &reg, const subview_col<uword> &plan,
+                      const district_tally &dt, const std::vector<int> &districts,
+                      int scope = CONSTR_ALL, vec *psi = nullptr);
+
+/*
+ * Change in `calc_gibbs_tgt()` for `districts` from `plan` to `new_plan`,
+ * whose totals are `dt` and `new_dt`
+ */
+double calc_gibbs_delta(const constr_registry &reg,
+                        const subview_col<uword> &plan, const district_tally &dt,
+                        const subview_col<uword> &new_plan, const district_tally &new_dt,
+                        const std::vector<int> &districts, int scope = CONSTR_ALL);
 
 #endif
@@ -12,30 +12,40 @@
  * Main entry point.
  *
  * USING MCMC
- * Sample `N` redistricting plans on map `g`, ensuring that the maximum
- * population deviation is between `lower` and `upper` (and ideally `target`)
+ * Sample `N` redistricting plans on map `g` from each of the chains started at
+ * the columns of `init`, ensuring that the maximum population deviation is
+ * between `lower` and `upper` (and ideally `target`)
  */
-Rcpp::List ms_plans(int N, List l, const uvec init, const uvec &counties, const uvec &pop,
+Rcpp::List ms_plans(int N, List l, const umat init, const uvec &counties, const uvec &pop,
               int n_distr, double target, double lower, double upper, double rho,
-              List constraints, double thresh, int k, int thin, int verbosity) {
+              List constraints, double thresh, int k, int thin, int ncores,
+              int verbosity, bool deltas) {
     // re-seed MT
     seed_rng((int) Rcpp::sample(INT_MAX, 1)[0]);
 
     Graph g = list_to_graph(l);
     Multigraph cg = county_graph(g, counties);
     int V = g.size();
-    int n_cty = max(counties);
+    int n_chains = init.n_cols;
+    if (init.n_rows != V)
+        throw std::range_error("Initialization plans have wrong dimensions.");
 
     int n_out = N/thin + 2;
-    umat districts(V, n_out, fill::zeros);
-    districts.col(0) = init;
-    districts.col(1) = init;
-
-    Rcpp::IntegerVector mh_decisions(N/thin + 1);
-    double mha;
+    // with `deltas`, only the initial plans are stored in full
+    umat districts(V, deltas ? 0 : n_chains * n_out, fill::zeros);
+    imat mh_decisions(N/thin + 1, n_chains, fill::zeros);
 
     double tol = std::max(target - lower, upper - target) / target;
 
+    // R objects may only be touched from the main thread, so chains with
+    // constraints evaluated through R are run one after another
+    bool parallel = n_chains > 1 && ncores != 1 && !has_r_constr(constraints);
+    // a single chain uses the threads to make several proposal attempts at once
+    bool speculative = n_chains == 1 && ncores != 1;
+    if (ncores <= 0) ncores = std::thread::hardware_concurrency();
+    int n_spec = speculative ? ncores : 0;
+    ncores = std::min(ncores, n_chains);
+
     if (verbosity >= 1) {
         Rcout.imbue(std::locale(""));
         Rcout << "MARKOV CHAIN MONTE CARLO\n";
@@ -45,117 +55,562 @@ Rcpp::List ms_plans(int N, List l, const uvec init, const uvec &counties, const
         if (cg.size() > 1)
             Rcout << "Sampling hierarchically with respect to the "
                   << cg.size() << " administrative units.\n";
+        if (n_chains > 1) {
+            Rcout << "Running " << n_chains << " chains";
+            if (parallel) Rcout << " on " << ncores << " threads";
+            Rcout << ".\n";
+        }
+        if (speculative)
+            Rcout << "Making " << n_spec << " proposal attempts at a time.\n";
     }
 
     // find k and multipliers
     if (k <= 0) {
-        adapt_ms_parameters(g, n_distr, k, thresh, tol, init, counties, cg, pop, target);
+        adapt_ms_parameters(g, n_distr, k, thresh, tol, init.col(0), counties, cg, pop,
+                            target, ncores);
     }
     if (verbosity >= 3)
         Rcout << "Using k = " << k << "\n";
 
-    int distr_1, distr_2;
-    select_pair(n_distr, g, init, distr_1, distr_2);
-    int n_accept = 0;
-    int reject_ct;
-    CharacterVector psi_names = CharacterVector::create(
-        "pop_dev", "splits", "multisplits",
-        "segregation", "grp_pow", "grp_hinge", "grp_inv_hinge",
-        "compet", "status_quo", "incumbency",
-        "polsby", "fry_hold", "log_st", "edges_removed",
-        "qps", "custom"
-    );
-    NumericVector new_psi(psi_names.size());
-    std::vector<int> distr_1_2;
-    new_psi.names() = psi_names;
-    RObject bar = cli_progress_bar(N - 1, cli_config(false));
-    int idx = 1;
-    for (int i = 1; i < N; i++) {
-        // copy old map to 'working' memory in `idx+1`
-        districts.col(idx+1) = districts.col(idx);
-
-        // make the proposal
-        double prop_lp = 0.0;
-        reject_ct = 0;
-        do {
-            select_pair(n_distr, g, districts.col(idx+1), distr_1, distr_2);
-            prop_lp = split_map_ms(g, counties, cg, districts.col(idx+1), distr_1,
-                                   distr_2, pop, lower, upper, target, k);
-            if (reject_ct % 200 == 0) Rcpp::checkUserInterrupt();
-            reject_ct++;
-        } while (!std::isfinite(prop_lp));
-
-        // tau calculations
-        if (rho != 1) {
-            double log_st = 0;
-            for (int j = 1; j <= n_cty; j++) {
-                log_st += log_st_distr(g, districts, counties, idx, distr_1, j);
-                log_st += log_st_distr(g, districts, counties, idx, distr_2, j);
-                log_st -= log_st_distr(g, districts, counties, idx+1, distr_1, j);
-                log_st -= log_st_distr(g, districts, counties, idx+1, distr_2, j);
+    // Gibbs target for each district of the current plan, for the constraints
+    // that depend only on the district itself; the rest are computed in full
+    constr_registry constr = make_constr_registry(constraints, pop, n_distr,
+                                                  target, g, false);
+
+    std::unique_ptr<RcppThread::ThreadPool> spec_pool;
+    if (speculative) spec_pool.reset(new RcppThread::ThreadPool(n_spec));
+    ms_input in{g, cg, counties, pop, n_distr, (int) max(counties), target, lower, upper,
+                rho, k, constr, spec_pool.get(), n_spec};
+
+    // every chain has its own random number stream
+    IntegerVector seeds = Rcpp::sample(INT_MAX, n_chains, true);
+    std::vector<ms_state> states(n_chains);
+    std::vector<ms_deltas> chain_deltas(deltas ? n_chains : 0);
+    std::vector<double> runtime(n_chains);
+    auto run_chain = [&] (int c, RObject *bar, RcppThread::ProgressBar *thread_bar) {
+        auto t1 = std::chrono::steady_clock::now();
+        seed_rng(seeds[c]);
+        init_ms_state(states[c], in, init.col(c));
+        ms_chain(states[c], in, districts, c * n_out, mh_decisions, c, N, thin,
+                 bar, thread_bar, deltas ? &chain_deltas[c] : nullptr);
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - t1;
+        runtime[c] = elapsed.count();
+    };
+
+    if (parallel) {
+        std::unique_ptr<RcppThread::ProgressBar> thread_bar;
+        if (verbosity >= 1)
+            thread_bar.reset(new RcppThread::ProgressBar(n_chains * (N - 1), 1));
+        RcppThread::ThreadPool pool(ncores);
+        pool.parallelFor(0, n_chains, [&] (int c) {
+            run_chain(c, nullptr, thread_bar.get());
+        });
+        pool.join();
+    } else {
+        for (int c = 0; c < n_chains; c++) {
+            if (verbosity >= 1 && (c == 0 || verbosity >= 3)) {
+                RObject bar = cli_progress_bar(N - 1, cli_config(false));
+                run_chain(c, &bar, nullptr);
+                cli_progress_done(bar);
+            } else {
+                run_chain(c, nullptr, nullptr);
             }
-            log_st += log_st_contr(g, districts, counties, n_cty, idx, distr_1);
-            log_st += log_st_contr(g, districts, counties, n_cty, idx, distr_2);
-            log_st -= log_st_contr(g, districts, counties, n_cty, idx+1, distr_1);
-            log_st -= log_st_contr(g, districts, counties, n_cty, idx+1, distr_2);
+        }
+    }
+    if (speculative) spec_pool->join();
 
-            prop_lp += (1 - rho) * log_st;
+    ivec n_accept(n_chains), n_tries(n_chains), n_abort(n_chains);
+    for (int c = 0; c < n_chains; c++) {
+        n_accept[c] = states[c].n_accept;
+        n_tries[c] = states[c].n_tries;
+        n_abort[c] = states[c].n_abort;
+    }
+    if (verbosity >= 1) {
+        Rcout << "Acceptance rate: " << std::setprecision(2)
+              << (100.0 * sum(n_accept)) / (n_chains * (N-1)) << "%\n";
+    }
+    if (verbosity >= 3) {
+        Rcout << "Proposals rejected early: " << std::setprecision(2)
+              << (100.0 * sum(n_abort)) / std::max((int) sum(n_tries), 1) << "%\n";
+    }
+
+    Rcpp::List out;
+    if (deltas) {
+        Rcpp::List out_deltas(n_chains);
+        for (int c = 0; c < n_chains; c++) {
+            out_deltas[c] = Rcpp::List::create(
+                _["ptr"] = chain_deltas[c].ptr,
+                _["vtx"] = chain_deltas[c].vtx,
+                _["distr"] = chain_deltas[c].distr
+            );
         }
+        out["plans"] = init;
+        out["deltas"] = out_deltas;
+    } else {
+        out["plans"] = districts;
+    }
+    out["mhdecisions"] = mh_decisions;
+    out["k"] = k;
+    out["runtime"] = runtime;
 
-        // add gibbs target
-        // NOTE: different signs than above b/c of how Metropolis proposal has
-        // transition ratio flipped relative to the target density ratio
-        distr_1_2 = {distr_1, distr_2};
-
-        prop_lp -= calc_gibbs_tgt(districts.col(idx+1), n_distr, V, distr_1_2, new_psi,
-                                  pop, target, g, constraints);
-        prop_lp += calc_gibbs_tgt(districts.col(idx), n_distr, V, distr_1_2, new_psi,
-                                  pop, target, g, constraints);
-
-        double alpha = exp(prop_lp);
-        if (alpha >= 1 || r_unif() <= alpha) { // ACCEPT
-            n_accept++;
-            districts.col(idx) = districts.col(idx+1); // copy over new map
-            mh_decisions(idx - 1) = 1;
-        } else { // REJECT
-            districts.col(idx+1) = districts.col(idx); // copy over old map
-            mh_decisions(idx - 1) = 0;
+    return out;
+}
+
+/*
+ * Materialize the stored plans `idxs` (0-indexed and increasing) of a chain
+ * stored as deltas, starting from `plan`, the stored plan `from`
+ */
+umat decode_ms_deltas(uvec plan, int from, const std::vector<int> &ptr,
+                      const std::vector<int> &vtx, const std::vector<int> &distr,
+                      const std::vector<int> &idxs) {
+    int n_idx = idxs.size();
+    int n_stored = ptr.size();
+    umat out(plan.n_elem, n_idx);
+
+    int j = from;
+    for (int i = 0; i < n_idx; i++) {
+        if (idxs[i] < j || idxs[i] >= n_stored)
+            throw std::range_error("Plan indices must be increasing and in range.");
+        for (; j < idxs[i]; j++) {
+            for (int e = ptr[j]; e < ptr[j + 1]; e++) {
+                plan[vtx[e]] = distr[e];
+            }
         }
+        out.col(i) = plan;
+    }
+
+    return out;
+}
+
+/*
+ * USING MCMC WITH PARALLEL TEMPERING
+ * Sample `N` redistricting plans on map `g` from chains at each inverse
+ * temperature in `betas`, which scale the compactness and constraint terms of
+ * the target. Every `swap_every` steps, adjacent chains propose to swap plans.
+ */
+Rcpp::List ms_tempered(int N, List l, const umat init, const uvec &counties,
+                       const uvec &pop, int n_distr, double target, double lower,
+                       double upper, double rho, List constraints, const vec betas,
+                       int swap_every, double thresh, int k, int thin, int ncores,
+                       int verbosity) {
+    // re-seed MT
+    seed_rng((int) Rcpp::sample(INT_MAX, 1)[0]);
 
-        if (i % thin == 0) idx++;
+    Graph g = list_to_graph(l);
+    Multigraph cg = county_graph(g, counties);
+    int V = g.size();
+    int n_temp = betas.n_elem;
+    if (init.n_rows != V || init.n_cols != n_temp)
+        throw std::range_error("Initialization plans have wrong dimensions.");
+    if (swap_every < 1)
+        throw std::range_error("`swap_every` must be positive.");
+
+    int n_out = N/thin + 2;
+    umat districts(V, n_temp * n_out, fill::zeros);
+    imat mh_decisions(N/thin + 1, n_temp, fill::zeros);
 
-        if (verbosity >= 1 && CLI_SHOULD_TICK) {
-            cli_progress_set(bar, i - 1);
-            mha = (double) n_accept / (i - 1);
-            cli_progress_set_format(bar, "{cli::pb_bar} {cli::pb_percent} | ETA: {cli::pb_eta} | MH Acceptance: %.2f", mha);
+    double tol = std::max(target - lower, upper - target) / target;
+
+    // R objects may only be touched from the main thread, so chains with
+    // constraints evaluated through R are run one after another
+    bool parallel = n_temp > 1 && ncores != 1 && !has_r_constr(constraints);
+    if (ncores <= 0) ncores = std::thread::hardware_concurrency();
+    ncores = std::min(ncores, n_temp);
+
+    if (verbosity >= 1) {
+        Rcout.imbue(std::locale(""));
+        Rcout << "MARKOV CHAIN MONTE CARLO WITH PARALLEL TEMPERING\n";
+        Rcout << std::fixed << std::setprecision(0);
+        Rcout << "Sampling " << N << " " << V << "-unit maps with " << n_distr
+              << " districts and population between " << lower << " and " << upper << ".\n";
+        if (cg.size() > 1)
+            Rcout << "Sampling hierarchically with respect to the "
+                  << cg.size() << " administrative units.\n";
+        Rcout << "Running " << n_temp << " chains";
+        if (parallel) Rcout << " on " << ncores << " threads";
+        Rcout << ".\n";
+    }
+
+    if (k <= 0) {
+        adapt_ms_parameters(g, n_distr, k, thresh, tol, init.col(0), counties, cg, pop,
+                            target, ncores);
+    }
+    if (verbosity >= 3)
+        Rcout << "Using k = " << k << "\n";
+
+    constr_registry constr = make_constr_registry(constraints, pop, n_distr,
+                                                  target, g, false);
+
+    ms_input in{g, cg, counties, pop, n_distr, (int) max(counties), target, lower, upper,
+                rho, k, constr, nullptr, 0};
+
+    // chains stay put and are moved between temperatures by swapping
+    // `chain_at`, the chain currently at each temperature
+    std::vector<ms_state> states(n_temp);
+    std::vector<int> chain_at(n_temp);
+    for (int t = 0; t < n_temp; t++) {
+        init_ms_state(states[t], in, init.col(t));
+        states[t].beta = betas[t];
+        chain_at[t] = t;
+        districts.col(t * n_out) = init.col(t);
+        districts.col(t * n_out + 1) = init.col(t);
+    }
+
+    // the last step which is stored, as in `ms_chain()`
+    int n_steps = 0;
+    for (int i = 1; i < N; i++) {
+        n_steps = i;
+        if (1 + i/thin == n_out - 1) break;
+    }
+
+    std::unique_ptr<RcppThread::ProgressBar> thread_bar;
+    if (verbosity >= 1)
+        thread_bar.reset(new RcppThread::ProgressBar(n_temp * n_steps, 1));
+    RcppThread::ThreadPool pool(parallel ? ncores : 0);
+
+    auto t1 = std::chrono::steady_clock::now();
+    ivec swap_accept(std::max(n_temp - 1, 0), fill::zeros);
+    ivec swap_tries(std::max(n_temp - 1, 0), fill::zeros);
+    ivec n_accept(n_temp, fill::zeros);
+    vec energy(n_temp);
+    int round = 0;
+    for (int start = 1; start <= n_steps; start += swap_every) {
+        int end = std::min(start + swap_every - 1, n_steps);
+
+        // every chain has its own random number stream in each round
+        IntegerVector seeds = Rcpp::sample(INT_MAX, n_temp, true);
+        pool.parallelFor(0, n_temp, [&] (int t) {
+            seed_rng(seeds[t]);
+            ms_state &st = states[chain_at[t]];
+            for (int i = start; i <= end; i++) {
+                int idx = 1 + (i - 1)/thin;
+                mh_decisions(idx - 1, t) = ms_step(st, in);
+                n_accept[t] += mh_decisions(idx - 1, t);
+                districts.col(t * n_out + idx) = st.plans.col(0);
+                districts.col(t * n_out + idx + 1) = st.plans.col(0);
+                if (thread_bar) (*thread_bar)++;
+            }
+        });
+        pool.wait();
+
+        // propose swaps between alternating pairs of adjacent temperatures
+        for (int t = 0; t < n_temp; t++) {
+            energy[t] = ms_energy(states[chain_at[t]], in);
         }
-        if (idx == n_out - 1) { // thin doesn't divide N and we are done early
-            cli_progress_set(bar, N);
-            break;
+        for (int t = round % 2; t < n_temp - 1; t += 2) {
+            swap_tries[t]++;
+            double alpha = exp((betas[t] - betas[t+1]) * (energy[t] - energy[t+1]));
+            if (alpha >= 1 || r_unif() <= alpha) {
+                swap_accept[t]++;
+                std::swap(chain_at[t], chain_at[t+1]);
+                states[chain_at[t]].beta = betas[t];
+                states[chain_at[t+1]].beta = betas[t+1];
+            }
         }
+        round++;
+
         Rcpp::checkUserInterrupt();
     }
-    cli_progress_done(bar);
-
+    pool.join();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - t1;
 
+    vec swap_rate(std::max(n_temp - 1, 0));
+    for (int t = 0; t < n_temp - 1; t++) {
+        swap_rate[t] = (double) swap_accept[t] / std::max((int) swap_tries[t], 1);
+    }
     if (verbosity >= 1) {
-        Rcout << "Acceptance rate: " << std::setprecision(2) << (100.0 * n_accept) / (N-1) << "%\n";
+        Rcout << "Acceptance rate: " << std::setprecision(2)
+              << (100.0 * n_accept[0]) / std::max(n_steps, 1) << "%\n";
+        Rcout << "Swap acceptance rates:";
+        for (int t = 0; t < n_temp - 1; t++) {
+            Rcout << " " << std::setprecision(2) << 100.0 * swap_rate[t] << "%";
+        }
+        Rcout << "\n";
     }
 
     Rcpp::List out;
     out["plans"] = districts;
     out["mhdecisions"] = mh_decisions;
+    out["swap_accept"] = swap_rate;
+    out["k"] = k;
+    out["runtime"] = elapsed.count();
 
     return out;
 }
 
+/*
+ * Set up the state of a merge-split chain at `plan`
+ */
+void init_ms_state(ms_state &st, const ms_input &in, const uvec &plan) {
+    int V = in.g.size();
+    int n_distr = in.n_distr;
+    int n_cty = in.n_cty;
+    st.plans = umat(V, 2);
+    st.plans.col(0) = plan;
+    st.plans.col(1) = plan;
+    st.distr_adj = district_adj(in.g, plan, n_distr);
+    if (in.pool != nullptr) st.spec = umat(V, in.n_spec);
+
+    // log spanning tree counts for each district of the current plan:
+    // one column per county, plus the contraction term in the last column
+    if (in.rho != 1) {
+        st.log_st = mat(n_distr, n_cty + 1);
+        st.log_st_prop = mat(2, n_cty + 1);
+        for (int d = 1; d <= n_distr; d++) {
+            for (int j = 1; j <= n_cty; j++) {
+                st.log_st(d - 1, j - 1) = log_st_distr(in.g, st.plans, in.counties, 0, d, j);
+            }
+            st.log_st(d - 1, n_cty) = log_st_contr(in.g, st.plans, in.counties, n_cty, 0, d);
+        }
+    }
+
+    st.dt = tally_plan(st.plans.col(0), in.constr.tally, n_distr);
+    st.dt_prop = st.dt;
+    st.tgt = vec(n_distr, fill::zeros);
+    if (has_constr(in.constr, CONSTR_LOCAL | CONSTR_NATIVE | CONSTR_R)) {
+        for (int d = 1; d <= n_distr; d++) {
+            st.tgt[d - 1] = calc_gibbs_tgt(in.constr, st.plans.col(0), st.dt, {d},
+                                           CONSTR_LOCAL | CONSTR_NATIVE | CONSTR_R);
+        }
+    }
+
+    st.n_accept = 0;
+    st.n_tries = 0;
+    st.n_abort = 0;
+}
+
+/*
+ * Make one Metropolis-Hastings step from the current plan in `st`.
+ * Returns whether the proposal was accepted.
+ */
+bool ms_step(ms_state &st, const ms_input &in) {
+    int n_distr = in.n_distr;
+    int n_cty = in.n_cty;
+    int distr_1, distr_2;
+
+    // make the proposal in the working column
+    double prop_lp = 0.0;
+    if (in.pool != nullptr) {
+        prop_lp = ms_propose_spec(st, in, distr_1, distr_2);
+    } else {
+        int reject_ct = 0;
+        do {
+            st.plans.col(1) = st.plans.col(0);
+            select_pair(n_distr, st.distr_adj, distr_1, distr_2);
+            prop_lp = split_map_ms(in.g, in.counties, in.cg, st.plans.col(1), distr_1,
+                                   distr_2, in.pop, in.lower, in.upper, in.target,
+                                   in.k, st.n_abort);
+            if (reject_ct % 200 == 0) RcppThread::checkUserInterrupt();
+            reject_ct++;
+        } while (!std::isfinite(prop_lp));
+        st.n_tries += reject_ct;
+    }
+
+    // compactness and constraint terms, scaled by the inverse temperature
+    double tgt_lp = 0.0;
+
+    // tau calculations; only the two new districts need to be computed
+    if (in.rho != 1) {
+        for (int j = 1; j <= n_cty; j++) {
+            st.log_st_prop(0, j - 1) = log_st_distr(in.g, st.plans, in.counties, 1, distr_1, j);
+            st.log_st_prop(1, j - 1) = log_st_distr(in.g, st.plans, in.counties, 1, distr_2, j);
+        }
+        st.log_st_prop(0, n_cty) = log_st_contr(in.g, st.plans, in.counties, n_cty, 1, distr_1);
+        st.log_st_prop(1, n_cty) = log_st_contr(in.g, st.plans, in.counties, n_cty, 1, distr_2);
+
+        double log_st = accu(st.log_st.row(distr_1 - 1)) +
+            accu(st.log_st.row(distr_2 - 1)) - accu(st.log_st_prop);
+
+        tgt_lp += (1 - in.rho) * log_st;
+    }
+
+    // add gibbs target
+    // NOTE: different signs than above b/c of how Metropolis proposal has
+    // transition ratio flipped relative to the target density ratio
+    std::vector<int> distr_1_2 = {distr_1, distr_2};
+    double tgt_prop_1 = 0, tgt_prop_2 = 0;
+    bool local = has_constr(in.constr, CONSTR_LOCAL | CONSTR_NATIVE | CONSTR_R);
+    bool global = has_constr(in.constr, CONSTR_GLOBAL | CONSTR_NATIVE | CONSTR_R);
+    if (local || global) {
+        // only the two new districts need to be totaled again
+        st.dt_prop = st.dt;
+        retally_plan(st.dt_prop, st.plans.col(1), in.constr.tally, distr_1, distr_2);
+    }
+    if (local) {
+        tgt_prop_1 = calc_gibbs_tgt(in.constr, st.plans.col(1), st.dt_prop, {distr_1},
+                                    CONSTR_LOCAL | CONSTR_NATIVE | CONSTR_R);
+        tgt_prop_2 = calc_gibbs_tgt(in.constr, st.plans.col(1), st.dt_prop, {distr_2},
+                                    CONSTR_LOCAL | CONSTR_NATIVE | CONSTR_R);
+        tgt_lp -= tgt_prop_1 + tgt_prop_2;
+        tgt_lp += st.tgt[distr_1 - 1] + st.tgt[distr_2 - 1];
+    }
+    if (global) {
+        tgt_lp -= calc_gibbs_delta(in.constr, st.plans.col(0), st.dt,
+                                   st.plans.col(1), st.dt_prop, distr_1_2,
+                                   CONSTR_GLOBAL | CONSTR_NATIVE | CONSTR_R);
+    }
+    prop_lp += st.beta * tgt_lp;
+
+    double alpha = exp(prop_lp);
+    if (alpha >= 1 || r_unif() <= alpha) { // ACCEPT
+        st.n_accept++;
+        st.plans.col(0) = st.plans.col(1); // copy over new map
+        update_district_adj(st.distr_adj, in.g, st.plans.col(0), distr_1, distr_2);
+        st.tgt[distr_1 - 1] = tgt_prop_1;
+        st.tgt[distr_2 - 1] = tgt_prop_2;
+        std::swap(st.dt, st.dt_prop);
+        if (in.rho != 1) {
+            st.log_st.row(distr_1 - 1) = st.log_st_prop.row(0);
+            st.log_st.row(distr_2 - 1) = st.log_st_prop.row(1);
+        }
+        return true;
+    } else { // REJECT
+        return false;
+    }
+}
+
+/*
+ * Draw a valid merge-split proposal into column 1 of `st.plans`, making
+ * `in.n_spec` attempts at a time on `in.pool`. Returns the log proposal ratio.
+ */
+double ms_propose_spec(ms_state &st, const ms_input &in, int &distr_1, int &distr_2) {
+    int n_spec = in.n_spec;
+    std::vector<int> seeds(n_spec);
+    std::vector<double> lp(n_spec);
+    std::vector<int> distr_1s(n_spec), distr_2s(n_spec), aborts(n_spec);
+
+    // Attempts are independent, so taking the first valid one in the order
+    // they were drawn (not the order they finish in) gives exactly the same
+    // proposal distribution as trying them one at a time.
+    int found = -1;
+    while (found < 0) {
+        for (int a = 0; a < n_spec; a++) {
+            seeds[a] = r_int(INT_MAX);
+        }
+        in.pool->parallelFor(0, n_spec, [&] (int a) {
+            seed_rng(seeds[a]);
+            st.spec.col(a) = st.plans.col(0);
+            select_pair(in.n_distr, st.distr_adj, distr_1s[a], distr_2s[a]);
+            aborts[a] = 0;
+            lp[a] = split_map_ms(in.g, in.counties, in.cg, st.spec.col(a),
+                                 distr_1s[a], distr_2s[a], in.pop, in.lower,
+                                 in.upper, in.target, in.k, aborts[a]);
+        });
+        in.pool->wait();
+
+        for (int a = 0; a < n_spec; a++) {
+            st.n_tries++;
+            st.n_abort += aborts[a];
+            if (std::isfinite(lp[a])) {
+                found = a;
+                break;
+            }
+        }
+        RcppThread::checkUserInterrupt();
+    }
+
+    st.plans.col(1) = st.spec.col(found);
+    distr_1 = distr_1s[found];
+    distr_2 = distr_2s[found];
+    return lp[found];
+}
+
+/*
+ * Compactness and constraint energy of the current plan in `st`, at beta = 1
+ */
+double ms_energy(const ms_state &st, const ms_input &in) {
+    int n_distr = in.n_distr;
+
+    double energy = accu(st.tgt);
+    if (in.rho != 1) {
+        energy += (1 - in.rho) * accu(st.log_st);
+    }
+    std::vector<int> all_distr(n_distr);
+    for (int d = 0; d < n_distr; d++) all_distr[d] = d + 1;
+    energy += calc_gibbs_tgt(in.constr, st.plans.col(0), st.dt, all_distr,
+                             CONSTR_GLOBAL | CONSTR_NATIVE | CONSTR_R);
+
+    return energy;
+}
+
+/*
+ * Run a merge-split chain for `N` steps from the plan in `st`, storing every
+ * `thin`-th plan in `districts` starting at column `start`, and the
+ * Metropolis-Hastings decisions in column `chain` of `mh_decisions`.
+ * Progress is reported to `bar` from the main thread, or to `thread_bar`
+ * from a worker thread; either may be null.
+ */
+void ms_chain(ms_state &st, const ms_input &in, umat &districts, int start,
+              imat &mh_decisions, int chain, int N, int thin,
+              RObject *bar, RcppThread::ProgressBar *thread_bar,
+              ms_deltas *deltas) {
+    int n_out = N/thin + 2;
+    if (deltas != nullptr) {
+        deltas->last = st.plans.col(0);
+        deltas->ptr.assign(1, 0);
+    } else {
+        districts.col(start) = st.plans.col(0);
+        districts.col(start + 1) = st.plans.col(0);
+    }
+
+    double mha;
+    int idx = 1;
+    for (int i = 1; i < N; i++) {
+        mh_decisions(idx - 1, chain) = ms_step(st, in);
+        if (deltas == nullptr) {
+            districts.col(start + idx) = st.plans.col(0);
+            districts.col(start + idx + 1) = st.plans.col(0);
+        }
+
+        if (i % thin == 0) {
+            if (deltas != nullptr) record_delta(*deltas, st.plans.col(0));
+            idx++;
+        }
+
+        if (bar != nullptr && CLI_SHOULD_TICK) {
+            cli_progress_set(*bar, i - 1);
+            mha = (double) st.n_accept / (i - 1);
+            cli_progress_set_format(*bar, "{cli::pb_bar} {cli::pb_percent} | ETA: {cli::pb_eta} | MH Acceptance: %.2f", mha);
+        }
+        if (thread_bar != nullptr) (*thread_bar)++;
+        if (idx == n_out - 1) { // thin doesn't divide N and we are done early
+            if (bar != nullptr) cli_progress_set(*bar, N);
+            break;
+        }
+        RcppThread::checkUserInterrupt();
+    }
+
+    // the remaining stored plans are all the final plan
+    if (deltas != nullptr) {
+        while ((int) deltas->ptr.size() < n_out) {
+            record_delta(*deltas, st.plans.col(0));
+        }
+    }
+}
+
+/*
+ * Store `plan` in `deltas` as the changes from the last stored plan
+ */
+void record_delta(ms_deltas &deltas, const subview_col<uword> &plan) {
+    int V = plan.n_elem;
+    for (int i = 0; i < V; i++) {
+        if (plan[i] != deltas.last[i]) {
+            deltas.vtx.push_back(i);
+            deltas.distr.push_back(plan[i]);
+            deltas.last[i] = plan[i];
+        }
+    }
+    deltas.ptr.push_back(deltas.vtx.size());
+}
+
 /*
  * Split a map into two pieces with population lying between `lower` and `upper`
+ * `n_abort` is incremented when the tree is rejected before it is finished
  */
 double split_map_ms(const Graph &g, const uvec &counties, Multigraph &cg,
                     subview_col<uword> districts, int distr_1, int distr_2,
                     const uvec &pop, double lower, double upper, double target,
-                    int k) {
+                    int k, int &n_abort) {
     int V = g.size();
     double orig_lb = log_boundary(g, districts, distr_1, distr_2);
 
@@ -172,8 +627,11 @@ double split_map_ms(const Graph &g, const uvec &counties, Multigraph &cg,
     }
 
     int root;
-    ust = sample_sub_ust(g, ust, V, root, ignore, pop, lower, upper, counties, cg);
-    if (ust.size() == 0) return -log(0.0);
+    ust = sample_sub_ust(g, ust, V, root, ignore, pop, lower, upper, counties, cg, true);
+    if (ust.size() == 0) {
+        if (root < 0) n_abort++;
+        return -log(0.0);
+    }
 
     // set `lower` as a way to return population of new district
     bool success = cut_districts_ms(ust, k, root, districts, distr_1, distr_2,
@@ -248,77 +706,102 @@ bool cut_districts_ms(Tree &ust, int k, int root, subview_col<uword> &districts,
 
 /*
  * Choose k and multiplier for efficient, accurate sampling
+ *
+ * Each tree, and the check of each candidate k, is drawn from its own random
+ * number stream with a fixed seed, on `ncores` threads. So the choice of k
+ * depends only on the inputs, and neither R's random number stream nor that
+ * of the calling thread is touched.
  */
 void adapt_ms_parameters(const Graph &g, int n_distr, int &k, double thresh,
                          double tol, const uvec &plan, const uvec &counties,
-                         Multigraph &cg, const uvec &pop, double target) {
+                         Multigraph &cg, const uvec &pop, double target, int ncores) {
     // sample some spanning trees and compute deviances
     int V = g.size();
     int k_max = std::min(20 + ((int) std::sqrt(V)), V - 1); // heuristic
     int N_adapt = (int) std::floor(4000.0 / sqrt((double) V));
+    // fixed, so that `ms_cached_k()` can reuse k; `set.seed()` has no effect
+    const int seed = 5118;
 
     double lower = target * (1 - tol);
     double upper = target * (1 + tol);
 
-    std::vector<std::vector<double>> devs;
-    vec distr_ok(k_max+1, fill::zeros);
-    int root;
-    int max_ok = 0;
-    std::vector<bool> ignore(V);
-    int distr_1, distr_2;
-    int max_V = 0;
-    for (int i = 0; i < N_adapt; i++) {
-        Tree ust = init_tree(V);
-
-        double joint_pop = 0;
-        select_pair(n_distr, g, plan, distr_1, distr_2);
-        int n_vtx = 0;
-        for (int j = 0; j < V; j++) {
-            if (plan(j) == distr_1 || plan(j) == distr_2) {
-                joint_pop += pop(j);
-                ignore[j] = false;
-                n_vtx++;
-            } else {
-                ignore[j] = true;
+    std::vector<std::vector<double>> devs(N_adapt);
+    std::vector<int> n_ok(N_adapt), n_vtx(N_adapt);
+    umat distr_adj = district_adj(g, plan, n_distr);
+
+    // always at least one worker thread, so that the calling thread's random
+    // number stream is left alone
+    RcppThread::ThreadPool pool(std::max(ncores, 1));
+    pool.parallelFor(0, N_adapt, [&] (int i) {
+        seed_rng(seed + i);
+        std::vector<bool> ignore(V);
+        int root, distr_1, distr_2;
+        while (true) {
+            Tree ust = init_tree(V);
+
+            double joint_pop = 0;
+            select_pair(n_distr, distr_adj, distr_1, distr_2);
+            n_vtx[i] = 0;
+            for (int j = 0; j < V; j++) {
+                if (plan(j) == distr_1 || plan(j) == distr_2) {
+                    joint_pop += pop(j);
+                    ignore[j] = false;
+                    n_vtx[i]++;
+                } else {
+                    ignore[j] = true;
+                }
             }
-        }
-        if (n_vtx > max_V) max_V = n_vtx;
 
-        ust = sample_sub_ust(g, ust, V, root, ignore, pop, lower, upper, counties, cg);
-        if (ust.size() == 0) {
-            i--;
-            continue;
-        }
+            ust = sample_sub_ust(g, ust, V, root, ignore, pop, lower, upper, counties, cg, false);
+            if (ust.size() == 0) continue;
 
-        devs.push_back(tree_dev(ust, root, pop, joint_pop, target));
-        int n_ok = 0;
-        for (int j = 0; j < V-1; j++) {
-            if (ignore[j]) devs.at(i).at(j) = 2; // force not to work
-            n_ok += devs.at(i).at(j) <= tol;
+            devs[i] = tree_dev(ust, root, pop, joint_pop, target);
+            n_ok[i] = 0;
+            for (int j = 0; j < V-1; j++) {
+                if (ignore[j]) devs[i][j] = 2; // force not to work
+                n_ok[i] += devs[i][j] <= tol;
+            }
+            break;
         }
+    });
+    pool.wait();
 
-        if (n_ok <= k_max)
-            distr_ok(n_ok) += 1.0 / N_adapt;
-        if (n_ok > max_ok && n_ok < k_max)
-            max_ok = n_ok;
+    int max_ok = 0;
+    int max_V = 0;
+    for (int i = 0; i < N_adapt; i++) {
+        if (n_vtx[i] > max_V) max_V = n_vtx[i];
+        if (n_ok[i] > max_ok && n_ok[i] < k_max)
+            max_ok = n_ok[i];
     }
 
     // For each k, compute pr(selected edge within top k),
     // among maps where valid edge was selected
-    uvec idxs(N_adapt);
-    for (k = 1; k <= k_max; k++) {
-        idxs = as<uvec>(Rcpp::sample(k, N_adapt, true, R_NilValue, false));
+    vec pr_within(k_max + 1, fill::zeros);
+    pool.parallelFor(1, k_max + 1, [&] (int kk) {
+        seed_rng(seed + N_adapt + kk);
+        // the k-th smallest deviation of each tree, sorted, so that the number
+        // of trees with a k-th deviation at least `dev` is a binary search
+        std::vector<double> kth(N_adapt);
+        for (int j = 0; j < N_adapt; j++) {
+            kth[j] = devs[j][kk-1];
+        }
+        std::sort(kth.begin(), kth.end());
+
         double sum_within = 0;
-        int n_ok = 0;
+        int n_valid = 0;
         for (int i = 0; i < N_adapt; i++) {
-            double dev = devs.at(i).at(idxs[i]);
+            double dev = devs[i][r_int(kk)];
             if (dev > tol) continue;
-            else n_ok++;
-            for (int j = 0; j < N_adapt; j++) {
-                sum_within += ((double) (dev <= devs.at(j).at(k-1))) / N_adapt;
-            }
+            else n_valid++;
+            int n_below = std::lower_bound(kth.begin(), kth.end(), dev) - kth.begin();
+            sum_within += ((double) (N_adapt - n_below)) / N_adapt;
         }
-        if (sum_within / n_ok >= thresh) break;
+        pr_within[kk] = sum_within / n_valid;
+    });
+    pool.join();
+
+    for (k = 1; k <= k_max; k++) {
+        if (pr_within[k] >= thresh) break;
     }
 
     if (k == k_max + 1) {
@@ -330,26 +813,78 @@ void adapt_ms_parameters(const Graph &g, int n_distr, int &k, double thresh,
 }
 
 /*
- * Select a pair of neighboring districts i, j
+ * Choose k for merge-split on map `g` starting from `plan`, as at the start
+ * of `ms_plans()`, so that it can be stored and reused from R
  */
-void select_pair(int n, const Graph &g, const uvec &plan, int &i, int &j) {
+int ms_adapt_k(List l, const uvec &plan, const uvec &counties, const uvec &pop,
+               int n_distr, double target, double lower, double upper,
+               double thresh, int ncores) {
+    Graph g = list_to_graph(l);
+    Multigraph cg = county_graph(g, counties);
+    double tol = std::max(target - lower, upper - target) / target;
+    if (ncores <= 0) ncores = std::thread::hardware_concurrency();
+
+    int k;
+    adapt_ms_parameters(g, n_distr, k, thresh, tol, plan, counties, cg, pop,
+                        target, ncores);
+    return k;
+}
+
+/*
+ * Count the edges between each pair of districts
+ */
+umat district_adj(const Graph &g, const uvec &plan, int n_distr) {
     int V = g.size();
-    i = 1 + r_int(n);
+    umat adj(n_distr, n_distr, fill::zeros);
+    for (int k = 0; k < V; k++) {
+        for (int nbor : g[k]) {
+            if (plan(nbor) == plan(k)) continue;
+            adj(plan(k) - 1, plan(nbor) - 1)++;
+        }
+    }
 
-    std::set<int> neighboring;
+    return adj;
+}
+
+/*
+ * Update the district edge counts `adj` after districts `distr_1` and
+ * `distr_2` of `plan` have been redrawn
+ */
+void update_district_adj(umat &adj, const Graph &g, const subview_col<uword> &plan,
+                         int distr_1, int distr_2) {
+    int V = g.size();
+    int d1 = distr_1 - 1;
+    int d2 = distr_2 - 1;
+    adj.row(d1).zeros();
+    adj.row(d2).zeros();
+    adj.col(d1).zeros();
+    adj.col(d2).zeros();
+    // only edges leaving the two districts can have changed
     for (int k = 0; k < V; k++) {
-        if (plan(k) != i) continue;
-        std::vector<int> nbors = g[k];
-        int length = nbors.size();
-        for (int l = 0; l < length; l++) {
-            int nbor = nbors[l];
-            if (plan(nbor) == i) continue;
-            neighboring.insert(plan[nbor]);
+        if (plan(k) != distr_1 && plan(k) != distr_2) continue;
+        for (int nbor : g[k]) {
+            if (plan(nbor) == plan(k)) continue;
+            adj(plan(k) - 1, plan(nbor) - 1)++;
+            if (plan(nbor) != distr_1 && plan(nbor) != distr_2)
+                adj(plan(nbor) - 1, plan(k) - 1)++;
         }
     }
+}
 
-    int n_nbor = neighboring.size();
-    j = *std::next(neighboring.begin(), r_int(n_nbor));
+/*
+ * Select a pair of neighboring districts i, j, using the district edge counts
+ */
+void select_pair(int n, const umat &adj, int &i, int &j) {
+    i = 1 + r_int(n);
 
-    return;
+    int n_nbor = 0;
+    for (int l = 0; l < n; l++) {
+        n_nbor += adj(i - 1, l) > 0;
+    }
+
+    // neighbors are taken in increasing order
+    int pick = r_int(n_nbor);
+    for (j = 1; j <= n; j++) {
+        if (adj(i - 1, j - 1) > 0 && pick-- == 0) break;
+    }
 }
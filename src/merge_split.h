@@ -4,7 +4,10 @@
 #include "smc_base.h"
 
 #include <string>
+#include <chrono>
+#include <memory>
 #include <cli/progress.h>
+#include <RcppThread.h>
 
 // [[Rcpp::depends(redistmetrics)]]
 
@@ -14,27 +17,142 @@
 #include <kirchhoff_inline.h>
 #include "mcmc_gibbs.h"
 
+/*
+ * Fixed inputs to a merge-split chain, shared by all chains
+ */
+struct ms_input {
+    const Graph &g;
+    Multigraph &cg;
+    const uvec &counties;
+    const uvec &pop;
+    int n_distr;
+    int n_cty;
+    double target;
+    double lower;
+    double upper;
+    double rho;
+    int k;
+    const constr_registry &constr;
+    RcppThread::ThreadPool *pool; // for speculative proposals, or null
+    int n_spec; // number of proposals attempted at once on `pool`
+};
+
+/*
+ * State of a merge-split chain
+ */
+struct ms_state {
+    umat plans; // current plan in column 0, proposal in column 1
+    umat distr_adj; // number of edges between each pair of districts
+    mat log_st; // log spanning tree terms for each district (if rho != 1)
+    mat log_st_prop; // same, for the two proposed districts
+    vec tgt; // Gibbs target of the local constraints for each district
+    district_tally dt; // district totals and county incidence for the constraints
+    district_tally dt_prop; // same, for the proposal
+    umat spec; // working plans for speculative proposals, one per attempt
+    double beta = 1.0; // inverse temperature: scales the compactness and constraint terms
+    int n_accept = 0;
+    int n_tries = 0;
+    int n_abort = 0;
+};
+
+/*
+ * Stored plans of a merge-split chain, as changes from the previous stored
+ * plan. The changes for stored plan `j` (starting at 1) are the units
+ * `vtx[ptr[j-1]]` to `vtx[ptr[j] - 1]` (0-indexed), which are moved to the
+ * districts in `distr` at the same positions.
+ */
+struct ms_deltas {
+    std::vector<int> ptr;
+    std::vector<int> vtx;
+    std::vector<int> distr;
+    uvec last; // last stored plan
+};
+
 /*
  * Main entry point.
  *
  * USING MCMMC
- * Sample `N` redistricting plans on map `g`, ensuring that the maximum
- * population deviation is between `lower` and `upper` (and ideally `target`)
+ * Sample `N` redistricting plans on map `g` from each of the chains started at
+ * the columns of `init`, ensuring that the maximum population deviation is
+ * between `lower` and `upper` (and ideally `target`)
  */
 // [[Rcpp::export]]
-Rcpp::List ms_plans(int N, List l, const arma::uvec init, const arma::uvec &counties,
+Rcpp::List ms_plans(int N, List l, const arma::umat init, const arma::uvec &counties,
                     const arma::uvec &pop, int n_distr, double target, double lower,
                     double upper, double rho, List constraints,
-                    double thresh, int k, int thin, int verbosity);
+                    double thresh, int k, int thin, int ncores, int verbosity,
+                    bool deltas = false);
+
+/*
+ * Materialize the stored plans `idxs` (0-indexed and increasing) of a chain
+ * stored as deltas, starting from `plan`, the stored plan `from`
+ */
+// [[Rcpp::export]]
+arma::umat decode_ms_deltas(arma::uvec plan, int from, const std::vector<int> &ptr,
+                            const std::vector<int> &vtx, const std::vector<int> &distr,
+                            const std::vector<int> &idxs);
+
+/*
+ * USING MCMC WITH PARALLEL TEMPERING
+ * Sample `N` redistricting plans on map `g` from chains at each inverse
+ * temperature in `betas`, which scale the compactness and constraint terms of
+ * the target. Every `swap_every` steps, adjacent chains propose to swap plans.
+ */
+// [[Rcpp::export]]
+Rcpp::List ms_tempered(int N, List l, const arma::umat init, const arma::uvec &counties,
+                       const arma::uvec &pop, int n_distr, double target, double lower,
+                       double upper, double rho, List constraints, const arma::vec betas,
+                       int swap_every, double thresh, int k, int thin, int ncores,
+                       int verbosity);
+
+/*
+ * Set up the state of a merge-split chain at `plan`
+ */
+void init_ms_state(ms_state &st, const ms_input &in, const uvec &plan);
+
+/*
+ * Make one Metropolis-Hastings step from the current plan in `st`.
+ * Returns whether the proposal was accepted.
+ */
+bool ms_step(ms_state &st, const ms_input &in);
+
+/*
+ * Draw a valid merge-split proposal into column 1 of `st.plans`, making
+ * `in.n_spec` attempts at a time on `in.pool`. Returns the log proposal ratio.
+ */
+double ms_propose_spec(ms_state &st, const ms_input &in, int &distr_1, int &distr_2);
+
+/*
+ * Compactness and constraint energy of the current plan in `st`, at beta = 1
+ */
+double ms_energy(const ms_state &st, const ms_input &in);
+
+/*
+ * Run a merge-split chain for `N` steps from the plan in `st`, storing every
+ * `thin`-th plan in `districts` starting at column `start`, or in `deltas`
+ * if it is not null, and the Metropolis-Hastings decisions in column `chain`
+ * of `mh_decisions`. Progress is reported to `bar` from the main thread, or
+ * to `thread_bar` from a worker thread; either may be null.
+ */
+void ms_chain(ms_state &st, const ms_input &in, umat &districts, int start,
+              imat &mh_decisions, int chain, int N, int thin,
+              RObject *bar, RcppThread::ProgressBar *thread_bar,
+              ms_deltas *deltas);
+
+/*
+ * Store `plan` in `deltas` as the changes from the last stored plan
+ */
+void record_delta(ms_deltas &deltas, const subview_col<uword> &plan);
 
 
 /*
  * Split a map into two pieces with population lying between `lower` and `upper`
+ * `n_abort` is incremented when the tree is rejected before it is finished
  */
 double split_map_ms(const Graph &g, const uvec &counties, Multigraph &cg,
                     subview_col<uword> districts, int distr_1, int distr_2,
                     const uvec &pop, double lower, double upper, double target,
-                    int k);
+                    int k, int &n_abort);
 
 /*
  * Cut district into two pieces of roughly equal population
@@ -45,15 +163,37 @@ bool cut_districts_ms(Tree &ust, int k, int root, subview_col<uword> &districts,
                       double lower, double upper, double target);
 
 /*
- * Choose k and multiplier for efficient, accurate sampling
+ * Choose k and multiplier for efficient, accurate sampling, drawing trees on
+ * `ncores` threads. The choice depends only on the inputs.
  */
 void adapt_ms_parameters(const Graph &g, int n_distr, int &k, double thresh,
                          double tol, const uvec &plan, const uvec &counties,
-                         Multigraph &cg, const uvec &pop, double target);
+                         Multigraph &cg, const uvec &pop, double target, int ncores);
+
+/*
+ * Choose k for merge-split on map `g` starting from `plan`, as at the start
+ * of `ms_plans()`, so that it can be stored and reused from R
+ */
+// [[Rcpp::export]]
+int ms_adapt_k(List l, const arma::uvec &plan, const arma::uvec &counties,
+               const arma::uvec &pop, int n_distr, double target, double lower,
+               double upper, double thresh, int ncores);
+
+/*
+ * Count the edges between each pair of districts
+ */
+umat district_adj(const Graph &g, const uvec &plan, int n_distr);
+
+/*
+ * Update the district edge counts `adj` after districts `distr_1` and
+ * `distr_2` of `plan` have been redrawn
+ */
+void update_district_adj(umat &adj, const Graph &g, const subview_col<uword> &plan,
+                         int distr_1, int distr_2);
 
 /*
- * Select a pair of neighboring districts i, j
+ * Select a pair of neighboring districts i, j, using the district edge counts
  */
-void select_pair(int n, const Graph &g, const uvec &plan, int &i, int &j);
+void select_pair(int n, const umat &adj, int &i, int &j);
 
 #endif
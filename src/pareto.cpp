@@ -1,11 +1,15 @@
-#include "smc_base.h"
+#include "pareto.h"
 
-// [[Rcpp::export]]
-LogicalVector pareto_dominated(arma::mat x) {
+/*
+ * Find the columns of `x` which are dominated by another column, where
+ * smaller values are better. Of a set of identical columns, all but one are
+ * considered dominated.
+ */
+std::vector<bool> find_dominated(const arma::mat &x) {
     int n = x.n_cols;
     int p = x.n_rows;
 
-    LogicalVector dominated(n); // initialized to FALSE
+    std::vector<bool> dominated(n, false);
     for (int i = 0; i < n; i++) { // for every el
         for (int j = 0; j < n; j++) { // for other non-dominated el
             if (i == j || dominated[j]) continue;
@@ -33,3 +37,8 @@ LogicalVector pareto_dominated(arma::mat x) {
 
     return dominated;
 }
+
+LogicalVector pareto_dominated(arma::mat x) {
+    std::vector<bool> dominated = find_dominated(x);
+    return LogicalVector(dominated.begin(), dominated.end());
+}
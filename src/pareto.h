@@ -0,0 +1,16 @@
+#ifndef PARETO_H
+#define PARETO_H
+
+#include "smc_base.h"
+
+/*
+ * Find the columns of `x` which are dominated by another column, where
+ * smaller values are better. Of a set of identical columns, all but one are
+ * considered dominated.
+ */
+std::vector<bool> find_dominated(const arma::mat &x);
+
+// [[Rcpp::export]]
+LogicalVector pareto_dominated(arma::mat x);
+
+#endif
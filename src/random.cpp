@@ -1,6 +1,14 @@
 #include "random.h"
+#include <mutex>
 
 std::random_device rd;
+static std::mutex rd_mutex;
+
+// draw from `rd`, which may be called by several threads at once
+static uint32_t rd_draw() {
+    std::lock_guard<std::mutex> lock(rd_mutex);
+    return rd();
+}
 
 
 /* This is a fixed-increment version of Java 8's SplittableRandom generator
@@ -9,7 +17,7 @@ std::random_device rd;
  Written in 2015 by Sebastiano Vigna (vigna@acm.org)
  [Public Domain]
  */
-static uint64_t state_sr; /* The state can be seeded with any value. */
+static thread_local uint64_t state_sr; /* The state can be seeded with any value. */
 uint64_t next_sr() {
     uint64_t z = (state_sr += 0x9e3779b97f4a7c15);
     z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
@@ -26,7 +34,8 @@ static inline uint32_t rotl(const uint32_t x, int k) {
     return (x << k) | (x >> (32 - k));
 }
 
-static uint32_t state_xo[4] = {rd(), rd(), rd(), rd()};
+// each thread has its own stream, so that parallel samplers can be seeded
+static thread_local uint32_t state_xo[4] = {rd_draw(), rd_draw(), rd_draw(), rd_draw()};
 
 uint32_t generator(void) {
     const uint32_t result = rotl(state_xo[0] + state_xo[3], 7) + state_xo[0];
@@ -48,7 +57,7 @@ uint32_t generator(void) {
 
 
 /*
- * Set RNG seed
+ * Set RNG seed for the calling thread
  */
 void seed_rng(int seed) {
     state_sr = seed;
@@ -9,7 +9,7 @@
 using namespace arma;
 
 /*
- * Set RNG seed
+ * Set RNG seed for the calling thread
  */
 void seed_rng(int seed);
 
@@ -1,4 +1,5 @@
 #include <Rcpp.h>
+#include <RcppThread.h>
 using namespace Rcpp;
 
 #include "hungarian.h"
@@ -77,3 +78,80 @@ IntegerMatrix solve_hungarian(NumericMatrix costMatrix) {
 
     return assign;
 }
+
+/*
+ * Renumber the districts of every plan (column of `plans`) to match those of
+ * `ref`, using the Hungarian algorithm to maximize the population which is in
+ * the same district under both. Returns the renumbered plans, the new number
+ * of each district of each plan (in the format of `renumber_matrix()`), and
+ * the fraction of the population sharing a district with `ref` in each plan.
+ */
+// [[Rcpp::export]]
+List match_plans(IntegerMatrix plans, IntegerVector ref, NumericVector pop,
+                 int ncores = 1) {
+    int V = plans.nrow();
+    int N = plans.ncol();
+    int k = max(ref);
+    double tot_pop = sum(pop);
+    if (ref.size() != V || pop.size() != V)
+        throw std::range_error("Reference plan and population must match the plans.");
+    for (R_xlen_t i = 0; i < plans.size(); i++) {
+        if (plans[i] < 1 || plans[i] > k)
+            throw std::range_error("Plans must have the same districts as the reference plan.");
+    }
+
+    IntegerMatrix out(V, N);
+    IntegerVector renumb(k * N);
+    NumericVector shared(N);
+    const int *plans_mem = plans.begin();
+    const int *ref_mem = ref.begin();
+    const double *pop_mem = pop.begin();
+    int *out_mem = out.begin();
+    int *renumb_mem = renumb.begin();
+    double *shared_mem = shared.begin();
+
+    // each chunk of plans reuses one joint table and solver
+    const int CHUNK = 64;
+    int n_chunks = (N + CHUNK - 1) / CHUNK;
+    RcppThread::ThreadPool pool(ncores > 1 ? ncores : 0);
+    pool.parallelFor(0, n_chunks, [&] (int c) {
+        std::vector<double> joint(k * k);
+        std::vector<double> cost(k * k);
+        std::vector<int> assignment(k);
+        std::vector<int> new_distr(k);
+        HungarianAlgorithm hung;
+
+        int n_end = std::min(N, (c + 1) * CHUNK);
+        for (int n = c * CHUNK; n < n_end; n++) {
+            const int *plan = plans_mem + (size_t) n * V;
+            // rows are `ref` districts and columns are `plan` districts
+            std::fill(joint.begin(), joint.end(), 0.0);
+            for (int i = 0; i < V; i++) {
+                joint[(ref_mem[i] - 1) + k * (plan[i] - 1)] += pop_mem[i];
+            }
+            for (int j = 0; j < k * k; j++) {
+                cost[j] = std::max(1.0 - joint[j] / tot_pop, 0.0);
+            }
+            hung.SolveColMajor(cost.data(), k, k, assignment.data());
+
+            // `ref` district `r` is matched to `plan` district `assignment[r]`
+            double same = 0;
+            for (int r = 0; r < k; r++) {
+                same += joint[r + k * assignment[r]];
+                new_distr[assignment[r]] = r + 1;
+            }
+            shared_mem[n] = same / tot_pop;
+            for (int d = 0; d < k; d++) {
+                renumb_mem[(size_t) k * n + d] = new_distr[d];
+            }
+            int *out_plan = out_mem + (size_t) n * V;
+            for (int i = 0; i < V; i++) {
+                out_plan[i] = new_distr[plan[i] - 1];
+            }
+        }
+    });
+    pool.wait();
+    pool.join();
+
+    return List::create(_["plans"] = out, _["renumb"] = renumb, _["shared"] = shared);
+}
@@ -0,0 +1,449 @@
+/********************************************************
+ * Purpose: Short-burst optimization with a resident
+ * merge-split chain and built-in scoring functions
+ ********************************************************/
+
+#include "shortburst.h"
+
+/*
+ * Main entry point.
+ *
+ * Optimize `score_fn` (or the built-in `scorer`, if it has any dimensions)
+ * with short bursts of merge-split, starting from `init`. Burst `i` has
+ * `burst_sizes[i]` steps. Scores are multiplied by `rescale` so that smaller
+ * values are better.
+ *
+ * `n_starts` trajectories are run side by side, and every `share_every`
+ * bursts their Pareto fronts are merged and each restarts from the merged
+ * front. Trajectories run on threads when every score is built in and there
+ * are no constraints.
+ */
+Rcpp::List ms_shortburst(List l, const uvec &init, const uvec &counties,
+                         const uvec &pop, int n_distr, double target,
+                         double lower, double upper, double rho, List constraints,
+                         int k, List scorer, RObject score_fn,
+                         const vec &rescale, const vec &stop_at,
+                         const IntegerVector &burst_sizes, int thin, int n_starts,
+                         int share_every, int ncores, CharacterVector improve_ch,
+                         int verbosity) {
+    // re-seed MT
+    seed_rng((int) Rcpp::sample(INT_MAX, 1)[0]);
+
+    Graph g = list_to_graph(l);
+    Multigraph cg = county_graph(g, counties);
+    int V = g.size();
+    int max_bursts = burst_sizes.size();
+    sb_scorer sb = parse_scorer(scorer, g);
+
+    constr_registry constr = make_constr_registry(constraints, pop, n_distr,
+                                                  target, g, false);
+
+    ms_input in{g, cg, counties, pop, n_distr, (int) max(counties), target, lower, upper,
+                rho, k, constr, nullptr, 0};
+
+    // R objects may only be touched from the main thread, so trajectories
+    // which call back into R are run one after another
+    bool parallel = n_starts > 1 && ncores != 1 && !has_r_constr(constraints)
+        && sb.size() > 0;
+    if (ncores <= 0) ncores = std::thread::hardware_concurrency();
+    ncores = std::min(ncores, n_starts);
+    if (n_starts == 1) share_every = 1;
+
+    // current Pareto front, with scores oriented so that smaller is better
+    umat front(V, 1);
+    front.col(0) = init;
+    mat front_scores = score_plans(sb, score_fn, front, g, pop, n_distr);
+    front_scores.each_col() %= rescale;
+    int dim = front_scores.n_rows;
+    vec stop_scaled = stop_at % rescale;
+
+    std::vector<sb_chain> chains(n_starts);
+    for (int c = 0; c < n_starts; c++) {
+        init_ms_state(chains[c].st, in, init);
+        chains[c].front = front;
+        chains[c].front_scores = front_scores;
+    }
+
+    int n_out = max_bursts / thin;
+    umat out_plans(V, n_out, fill::zeros);
+    mat out_scores(n_out, dim, fill::zeros);
+
+    int n_ch = improve_ch.size();
+    int improve_ct = 0;
+    int report_int = std::max((int) std::round(max_bursts / 10.0), 1);
+    char buf[32];
+    auto print_burst = [&] (int burst, const std::string &mark, const vec &sc) {
+        std::snprintf(buf, sizeof(buf), "% 5d", burst);
+        Rcout << buf << "     " << mark << "     ";
+        for (int d = 0; d < dim; d++) {
+            std::snprintf(buf, sizeof(buf), "%f", sc[d] * rescale[d]);
+            Rcout << (d > 0 ? " " : "") << buf;
+        }
+        Rcout << "\n";
+    };
+
+    // The best single score so far, published by each trajectory as soon as
+    // it improves on it, so that an improvement is only reported once.
+    // Multidimensional scores are compared on the merged front instead.
+    std::atomic<double> best(front_scores(0, 0));
+    // set by the first trajectory to reach `stop_at`; the others finish
+    // their current burst and stop
+    std::atomic<bool> done(false);
+
+    // what each trajectory saw after each burst of a round
+    mat rec_scores(dim, n_starts * share_every);
+    std::vector<int> rec_improved(n_starts * share_every);
+    std::vector<int> rec_stop(n_starts * share_every);
+    int n_rec = share_every / thin + 1; // stored plans per trajectory per round
+    umat rec_plans(V, n_starts * n_rec);
+    std::vector<int> n_run(n_starts);
+
+    RcppThread::ThreadPool pool(parallel ? ncores : 0);
+    int idx = 0;
+    int burst = 0;
+    bool converged = false;
+    for (int start = 1; start <= max_bursts && !converged; start += share_every) {
+        int n_round = std::min(share_every, max_bursts - start + 1);
+        int first_out = (start - 1) / thin + 1; // first stored burst, if any
+
+        // every trajectory has its own random number stream in each round
+        IntegerVector seeds = Rcpp::sample(INT_MAX, n_starts, true);
+        pool.parallelFor(0, n_starts, [&] (int c) {
+            seed_rng(seeds[c]);
+            sb_chain &ch = chains[c];
+            n_run[c] = 0;
+            for (int b = 0; b < n_round && !done.load(); b++) {
+                int i = c * share_every + b;
+                bool improved = run_burst(ch, in, sb, score_fn, rescale,
+                                          burst_sizes[start + b - 1]);
+                if (improved && dim == 1) {
+                    // publish our best score if it beats everyone else's
+                    double ours = ch.front_scores(0, 0);
+                    double cur = best.load();
+                    improved = false;
+                    while (ours < cur && !(improved = best.compare_exchange_weak(cur, ours))) {}
+                }
+
+                int out_idx = r_int(ch.front.n_cols); // random plan from frontier
+                rec_scores.col(i) = ch.front_scores.col(out_idx);
+                rec_improved[i] = improved;
+                rec_stop[i] = false;
+                if ((start + b) % thin == 0) {
+                    rec_plans.col(c * n_rec + (start + b) / thin - first_out) =
+                        ch.front.col(out_idx);
+                    for (int j = 0; j < (int) ch.front.n_cols; j++) {
+                        if (all(ch.front_scores.col(j) <= stop_scaled)) rec_stop[i] = true;
+                    }
+                    if (rec_stop[i]) done = true;
+                }
+                n_run[c] = b + 1;
+            }
+        });
+        pool.wait();
+
+        // report each burst of the round, across all trajectories
+        for (int b = 0; b < n_round; b++) {
+            std::vector<int> ran;
+            for (int c = 0; c < n_starts; c++) {
+                if (n_run[c] > b) ran.push_back(c);
+            }
+            if (ran.size() == 0) break;
+            burst = start + b;
+
+            mat cand(dim, ran.size());
+            bool improved = false;
+            bool stop = false;
+            for (int r = 0; r < (int) ran.size(); r++) {
+                int i = ran[r] * share_every + b;
+                cand.col(r) = rec_scores.col(i);
+                improved = improved || rec_improved[i];
+                stop = stop || rec_stop[i];
+            }
+            std::vector<bool> dominated = find_dominated(cand);
+            std::vector<int> best_r;
+            for (int r = 0; r < (int) ran.size(); r++) {
+                if (!dominated[r]) best_r.push_back(r);
+            }
+            int r_out = best_r[r_int(best_r.size())];
+            int c_out = ran[r_out];
+
+            if (verbosity >= 1) {
+                if (improved) {
+                    improve_ct = (improve_ct + 1) % n_ch;
+                    print_burst(burst, as<std::string>(improve_ch[improve_ct]), cand.col(r_out));
+                } else if (burst % report_int == 0) {
+                    print_burst(burst, "  ", cand.col(r_out));
+                }
+            }
+
+            if (burst % thin == 0) {
+                idx = burst / thin;
+                out_plans.col(idx - 1) = rec_plans.col(c_out * n_rec + idx - first_out);
+                out_scores.row(idx - 1) = (cand.col(r_out) % rescale).t();
+                if (stop) {
+                    converged = true;
+                    break;
+                }
+            }
+        }
+
+        // merge the fronts, and restart every trajectory from the result
+        umat all_plans = chains[0].front;
+        mat all_scores = chains[0].front_scores;
+        for (int c = 1; c < n_starts; c++) {
+            all_plans = join_rows(all_plans, chains[c].front);
+            all_scores = join_rows(all_scores, chains[c].front_scores);
+        }
+        std::vector<bool> dominated = find_dominated(all_scores);
+        std::vector<uword> keep;
+        for (int i = 0; i < (int) dominated.size(); i++) {
+            if (!dominated[i]) keep.push_back(i);
+        }
+        uvec keep_idx(keep);
+        front = all_plans.cols(keep_idx);
+        front_scores = all_scores.cols(keep_idx);
+        for (int c = 0; c < n_starts; c++) {
+            chains[c].front = front;
+            chains[c].front_scores = front_scores;
+        }
+
+        Rcpp::checkUserInterrupt();
+    }
+    pool.join();
+
+    Rcpp::List out;
+    out["plans"] = out_plans.cols(0, std::max(idx, 1) - 1);
+    out["scores"] = out_scores.rows(0, std::max(idx, 1) - 1);
+    out["n_out"] = idx;
+    out["pareto_front"] = front;
+    out["pareto_scores"] = front_scores;
+    out["n_bursts"] = burst;
+    out["converged"] = converged;
+
+    return out;
+}
+
+/*
+ * Run one burst of `n_steps` merge-split steps from a random plan on the
+ * front of `ch`, and add the new plans to the front. Returns true if any of
+ * them are on the new front.
+ */
+bool run_burst(sb_chain &ch, const ms_input &in, const sb_scorer &scorer,
+               RObject score_fn, const vec &rescale, int n_steps) {
+    int V = in.g.size();
+
+    // restart the chain from a random plan on the frontier, unless it is
+    // already there
+    int start = r_int(ch.front.n_cols);
+    if (any(ch.st.plans.col(0) != ch.front.col(start))) {
+        init_ms_state(ch.st, in, ch.front.col(start));
+    }
+
+    umat plans(V, n_steps);
+    for (int i = 0; i < n_steps; i++) {
+        ms_step(ch.st, in);
+        plans.col(i) = ch.st.plans.col(0);
+    }
+    mat scores = score_plans(scorer, score_fn, plans, in.g, in.pop, in.n_distr);
+    scores.each_col() %= rescale;
+
+    umat all_plans = join_rows(ch.front, plans);
+    mat all_scores = join_rows(ch.front_scores, scores);
+    std::vector<bool> dominated = find_dominated(all_scores);
+    int n_all = dominated.size();
+    bool improved = false;
+    for (int i = n_all - n_steps; i < n_all; i++) {
+        if (!dominated[i]) improved = true;
+    }
+
+    // remove dominated plans
+    std::vector<uword> keep;
+    for (int i = 0; i < n_all; i++) {
+        if (!dominated[i]) keep.push_back(i);
+    }
+    uvec keep_idx(keep);
+    ch.front = all_plans.cols(keep_idx);
+    ch.front_scores = all_scores.cols(keep_idx);
+
+    return improved;
+}
+
+/*
+ * Convert the `native` attribute of an R scoring function to a `sb_scorer`
+ */
+sb_scorer parse_scorer(List scorer, const Graph &g) {
+    int V = g.size();
+    double n_edges = 0;
+    for (int i = 0; i < V; i++) {
+        n_edges += g[i].size();
+    }
+    n_edges /= 2;
+
+    sb_scorer out(scorer.size());
+    for (int d = 0; d < scorer.size(); d++) {
+        List terms = scorer[d];
+        for (int i = 0; i < terms.size(); i++) {
+            List t = terms[i];
+            std::string type = as<std::string>(t["type"]);
+            sb_term term;
+            term.weight = as<double>(t["weight"]);
+            term.k = 1;
+            term.denom = 1;
+            if (type == "frac_kept") {
+                term.type = SB_FRAC_KEPT;
+                term.denom = n_edges;
+            } else if (type == "group_pct") {
+                term.type = SB_GROUP_PCT;
+                term.x = as<vec>(t["group_pop"]);
+                term.y = as<vec>(t["total_pop"]);
+                term.k = as<int>(t["k"]);
+            } else if (type == "pop_dev") {
+                term.type = SB_POP_DEV;
+            } else if (type == "splits") {
+                term.type = SB_SPLITS;
+                term.ref = as<uvec>(t["counties"]);
+                term.k = as<int>(t["max_split"]);
+                term.denom = max(term.ref);
+            } else if (type == "polsby") {
+                term.type = SB_POLSBY;
+                term.x = as<vec>(t["area"]);
+                term.y = as<vec>(t["perimeter"]);
+                term.from = as<ivec>(t["from"]);
+                term.to = as<ivec>(t["to"]);
+                term.perim = make_perim_index(term.from, term.to, term.y, g.size());
+                term.k = as<int>(t["m"]);
+            } else if (type == "status_quo") {
+                term.type = SB_STATUS_QUO;
+                term.ref = as<uvec>(t["existing_plan"]);
+            } else {
+                throw std::invalid_argument("Unknown scorer type `" + type + "`.");
+            }
+            out[d].push_back(term);
+        }
+    }
+
+    return out;
+}
+
+/*
+ * Score every column of `plans` with the built-in `scorer`, or by calling
+ * `score_fn` once if `scorer` is empty. Returns one column of scores per plan.
+ */
+mat score_plans(const sb_scorer &scorer, RObject score_fn, const umat &plans,
+                const Graph &g, const uvec &pop, int n_distr) {
+    int n = plans.n_cols;
+    if (scorer.size() == 0) {
+        Function fn(score_fn);
+        imat int_plans = conv_to<imat>::from(plans);
+        // a vector or a matrix with one row per plan
+        NumericVector res = fn(int_plans);
+        if (n == 0 || res.size() == 0 || res.size() % n != 0)
+            throw std::range_error("`score_fn` must return one score per plan.");
+        mat scores(res.begin(), n, res.size() / n);
+        return scores.t();
+    }
+
+    int dim = scorer.size();
+    mat scores(dim, n, fill::zeros);
+    for (int i = 0; i < n; i++) {
+        const subview_col<uword> plan = plans.col(i);
+        for (int d = 0; d < dim; d++) {
+            for (const sb_term &term : scorer[d]) {
+                scores(d, i) += term.weight * eval_sb_term(term, plan, g, pop, n_distr);
+            }
+        }
+    }
+
+    return scores;
+}
+
+/*
+ * Evaluate one built-in scoring function on `plan`
+ */
+double eval_sb_term(const sb_term &term, const subview_col<uword> &plan,
+                    const Graph &g, const uvec &pop, int n_distr) {
+    int V = plan.n_elem;
+    switch (term.type) {
+    case SB_FRAC_KEPT: {
+        double n_kept = 0;
+        for (int i = 0; i < V; i++) {
+            for (int j : g[i]) {
+                if (j > i && plan[i] == plan[j]) n_kept++;
+            }
+        }
+        return n_kept / term.denom;
+    }
+    case SB_GROUP_PCT: {
+        std::vector<double> grp(n_distr, 0.0);
+        std::vector<double> tot(n_distr, 0.0);
+        for (int i = 0; i < V; i++) {
+            grp[plan[i] - 1] += term.x[i];
+            tot[plan[i] - 1] += term.y[i];
+        }
+        for (int d = 0; d < n_distr; d++) {
+            grp[d] /= tot[d];
+        }
+        std::nth_element(grp.begin(), grp.begin() + term.k - 1,
+                         grp.end(), std::greater<double>());
+        return grp[term.k - 1];
+    }
+    case SB_POP_DEV: {
+        std::vector<double> distr_pop(n_distr, 0.0);
+        double total_pop = 0;
+        for (int i = 0; i < V; i++) {
+            distr_pop[plan[i] - 1] += pop[i];
+            total_pop += pop[i];
+        }
+        double target = total_pop / n_distr;
+        double dev = 0;
+        for (int d = 0; d < n_distr; d++) {
+            dev = std::max(dev, std::fabs(distr_pop[d] / target - 1.0));
+        }
+        return dev;
+    }
+    case SB_SPLITS: {
+        cty_incidence inc;
+        tally_counties(inc, plan, term.ref, term.denom, n_distr);
+        int n_split = accu(inc.n_distr > (uword) term.k);
+        return n_split / term.denom;
+    }
+    case SB_POLSBY: {
+        std::vector<double> area(n_distr, 0.0);
+        for (int i = 0; i < V; i++) {
+            area[plan[i] - 1] += term.x[i];
+        }
+        vec perim = tally_perims(term.perim, plan, n_distr);
+        double pi4 = 4.0*3.14159265;
+        for (int d = 0; d < n_distr; d++) {
+            area[d] = pi4 * area[d] / (perim[d + 1] * perim[d + 1]);
+        }
+        std::nth_element(area.begin(), area.begin() + term.k - 1, area.end());
+        return area[term.k - 1];
+    }
+    case SB_STATUS_QUO: {
+        mat joint(n_distr, n_distr, fill::zeros);
+        vec p1(n_distr, fill::zeros);
+        vec p2(n_distr, fill::zeros);
+        double total_pop = 0;
+        for (int i = 0; i < V; i++) {
+            joint(term.ref[i] - 1, plan[i] - 1) += pop[i];
+            p1[term.ref[i] - 1] += pop[i];
+            p2[plan[i] - 1] += pop[i];
+            total_pop += pop[i];
+        }
+
+        double varinf = 0;
+        for (int i = 0; i < n_distr; i++) {
+            for (int j = 0; j < n_distr; j++) {
+                double jo = joint(i, j);
+                if (jo < 1) continue;
+                varinf -= (jo / total_pop) * (2.0*std::log(jo) - std::log(p1[i]) - std::log(p2[j]));
+            }
+        }
+        if (std::fabs(varinf) <= 1e-9) varinf = 0;
+        return 1 - 0.5 * varinf / std::log((double) n_distr);
+    }
+    }
+
+    return 0;
+}
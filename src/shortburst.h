@@ -0,0 +1,106 @@
+#ifndef SHORTBURST_H
+#define SHORTBURST_H
+
+#include "smc_base.h"
+
+#include <string>
+#include <cstdio>
+#include <atomic>
+#include <thread>
+
+#include "merge_split.h"
+#include "pareto.h"
+
+/*
+ * Built-in scoring functions, matching the `scorer_*()` functions in R
+ */
+enum sb_type {
+    SB_FRAC_KEPT,
+    SB_GROUP_PCT,
+    SB_POP_DEV,
+    SB_SPLITS,
+    SB_POLSBY,
+    SB_STATUS_QUO
+};
+
+/*
+ * One built-in scoring function, with its weight in a linear combination
+ */
+struct sb_term {
+    sb_type type;
+    double weight;
+    int k; // which order statistic to return, or the maximum number of splits
+    double denom; // number of edges or counties
+    vec x; // group population or areas
+    vec y; // total population or perimeters
+    uvec ref; // counties or existing plan
+    ivec from;
+    ivec to;
+    perim_index perim; // built from `from`, `to`, and the perimeters
+};
+
+/*
+ * Each dimension of a score, as a linear combination of built-in scorers
+ */
+typedef std::vector<std::vector<sb_term>> sb_scorer;
+
+/*
+ * One short-burst trajectory: a merge-split chain and its Pareto front, with
+ * scores oriented so that smaller is better
+ */
+struct sb_chain {
+    ms_state st;
+    umat front;
+    mat front_scores;
+};
+
+/*
+ * Main entry point.
+ *
+ * Optimize `score_fn` (or the built-in `scorer`, if it has any dimensions)
+ * with short bursts of merge-split, starting from `init`. Burst `i` has
+ * `burst_sizes[i]` steps. Scores are multiplied by `rescale` so that smaller
+ * values are better.
+ *
+ * `n_starts` trajectories are run side by side, and every `share_every`
+ * bursts their Pareto fronts are merged and each restarts from the merged
+ * front. Trajectories run on threads when every score is built in and there
+ * are no constraints.
+ */
+// [[Rcpp::export]]
+Rcpp::List ms_shortburst(List l, const arma::uvec &init, const arma::uvec &counties,
+                         const arma::uvec &pop, int n_distr, double target,
+                         double lower, double upper, double rho, List constraints,
+                         int k, List scorer, RObject score_fn,
+                         const arma::vec &rescale, const arma::vec &stop_at,
+                         const IntegerVector &burst_sizes, int thin, int n_starts,
+                         int share_every, int ncores, CharacterVector improve_ch,
+                         int verbosity);
+
+/*
+ * Run one burst of `n_steps` merge-split steps from a random plan on the
+ * front of `ch`, and add the new plans to the front. Returns true if any of
+ * them are on the new front.
+ */
+bool run_burst(sb_chain &ch, const ms_input &in, const sb_scorer &scorer,
+               RObject score_fn, const vec &rescale, int n_steps);
+
+/*
+ * Convert the `native` attribute of an R scoring function to a `sb_scorer`
+ */
+sb_scorer parse_scorer(List scorer, const Graph &g);
+
+/*
+ * Score every column of `plans` with the built-in `scorer`, or by calling
+ * `score_fn` once if `scorer` is empty. Returns one column of scores per plan.
+ */
+mat score_plans(const sb_scorer &scorer, RObject score_fn, const umat &plans,
+                const Graph &g, const uvec &pop, int n_distr);
+
+/*
+ * Evaluate one built-in scoring function on `plan`
+ */
+double eval_sb_term(const sb_term &term, const subview_col<uword> &plan,
+                    const Graph &g, const uvec &pop, int n_distr);
+
+#endif
@@ -28,6 +28,7 @@ List smc_plans(int N, List l, const uvec &counties, const uvec &pop,
     double est_label_mult = (double) control["est_label_mult"];
     bool adjust_labels = (bool) control["adjust_labels"];
     double final_infl = (double) control["final_infl"];
+    bool multiple_try = (bool) control["multiple_try"];
     std::vector<int> lags = as<std::vector<int>>(control["lags"]);
 
     int cores = (int) control["cores"];
@@ -103,6 +104,7 @@ List smc_plans(int N, List l, const uvec &counties, const uvec &pop,
     std::vector<int> n_unique(n_steps);
     std::vector<double> n_eff(n_steps);
     std::vector<double> accept_rate(n_steps);
+    std::vector<double> abort_rate(n_steps);
     std::vector<double> sd_labels(n_steps);
     std::vector<double> sd_lp(n_steps);
     std::vector<double> sd_temper(n_steps);
@@ -126,6 +128,8 @@ List smc_plans(int N, List l, const uvec &counties, const uvec &pop,
     umat progenitor_mat(n_steps + 1, N, fill::zeros);
 
     RcppThread::ThreadPool pool(cores);
+    constr_registry constr = make_constr_registry(constraints, pop, n_distr,
+                                                  target, g, true);
 
     // Peter Note: The initial splits are taken to be their own parents.
     for (unsigned int i = 0; i < N; i++)
@@ -165,11 +169,11 @@ List smc_plans(int N, List l, const uvec &counties, const uvec &pop,
         }
 
         split_maps(g, counties, cg, pop, districts, cum_wgt, lp, pop_left,
-                   log_temper, pop_temper, accept_rate[i_split],
+                   log_temper, pop_temper, accept_rate[i_split], abort_rate[i_split],
                    n_distr, ctr, dist_grs, log_labels, ancestors, lags,
                    adjust_labels, est_label_mult, n_unique[i_split],
                    lower, upper, target,
-                   rho, cut_k[i_split], check_both, pool, verbosity,
+                   rho, cut_k[i_split], check_both, multiple_try, pool, verbosity,
                    b2_mat, progenitor_mat);
 
         vec inc_only = lp - log_labels;
@@ -182,8 +186,7 @@ List smc_plans(int N, List l, const uvec &counties, const uvec &pop,
 
         // compute weights for next step
         cum_wgt = get_wgts(districts, n_distr, ctr, final, alpha, lp,
-                           n_eff[i_split], pop, target, g, constraints,
-                           verbosity);
+                           n_eff[i_split], constr, pool, verbosity);
 
         probs_mat(ctr - 1, 0) = cum_wgt(0);
         for (int i = 1; i < cum_wgt.n_elem - 1; i++)
@@ -252,6 +255,7 @@ List smc_plans(int N, List l, const uvec &counties, const uvec &pop,
         _["step_n_eff"] = n_eff,
         _["unique_survive"] = n_unique,
         _["accept_rate"] = accept_rate,
+        _["early_reject"] = abort_rate,
         _["b1_probs_mat"] = probs_mat,
         _["b2_wgts_mat"] = b2_mat,
         _["all_progenitors"] = progenitor_mat);
@@ -261,32 +265,12 @@ List smc_plans(int N, List l, const uvec &counties, const uvec &pop,
 
 
 /*
- * Helper function to iterate over constraints and apply them
- */
-double add_constraint(const std::string &name, List constraints,
-                      std::function<double(List)> fn_constr) {
-    if (!constraints.containsElementNamed(name.c_str())) return 0;
-
-    List constr = constraints[name];
-    double val = 0;
-    for (int i = 0; i < constr.size(); i++) {
-        List constr_inst = constr[i];
-        double strength = constr_inst["strength"];
-        if (strength != 0) {
-            val += strength * fn_constr(constr_inst);
-        }
-    }
-    return val;
-}
-
-/*
- * Add specific constraint weights & return the cumulative weight vector
+ * Add specific constraint weights & return the cumulative weight vector.
+ * Constraints evaluated in C++ are evaluated for each plan on `pool`.
  */
 vec get_wgts(const umat &districts, int n_distr, int distr_ctr, bool final,
-             double alpha, vec &lp, double &neff,
-             const uvec &pop, double parity, const Graph g,
-             List constraints, int verbosity) {
-    int V = districts.n_rows;
+             double alpha, vec &lp, double &neff, const constr_registry &constr,
+             RcppThread::ThreadPool &pool, int verbosity) {
     int N = districts.n_cols;
 
     std::vector<int> distr_calc;
@@ -296,108 +280,39 @@ vec get_wgts(const umat &districts, int n_distr, int distr_ctr, bool final,
         distr_calc = {distr_ctr};
     }
 
-    if (constraints.size() > 0) {
-    for (int i = 0; i < N; i++) {
+    if (has_constr(constr, CONSTR_ALL ^ CONSTR_R)) {
+        // district totals and county incidence come from a single pass over
+        // each plan's units
+        pool.parallelFor(0, N, [&] (int i) {
+            district_tally dt = tally_plan(districts.col(i), constr.tally, n_distr);
+            lp[i] += calc_gibbs_tgt(constr, districts.col(i), dt, distr_calc,
+                                    CONSTR_ALL ^ CONSTR_R);
+        });
+        pool.wait();
+    }
+
+    // custom constraints call into R, so are evaluated here; batched ones
+    // see every particle in one call
+    const district_tally no_tally; // not used by custom constraints
+    for (const constr_term &term : constr.terms) {
+        if (term.type != CONSTR_CUSTOM) continue;
+        Function fn(term.fn);
         for (int j : distr_calc) {
-            lp[i] += add_constraint("pop_dev", constraints,
-                                      [&] (List l) -> double {
-                                          return eval_pop_dev(districts.col(i), j,
-                                                                 pop, parity);
-                                      });
-
-            lp[i] += add_constraint("status_quo", constraints,
-                [&] (List l) -> double {
-                    return eval_sq_entropy(districts.col(i), as<uvec>(l["current"]),
-                                           j, pop, n_distr,
-                                           as<int>(l["n_current"]), V);
-                });
-
-            lp[i] += add_constraint("segregation", constraints,
-                                      [&] (List l) -> double {
-                                          return eval_segregation(districts.col(i), j,
-                                                                  as<uvec>(l["group_pop"]), as<uvec>(l["total_pop"]));
-                                      });
-
-            lp[i] += add_constraint("grp_pow", constraints,
-                [&] (List l) -> double {
-                    return eval_grp_pow(districts.col(i), j,
-                                        as<uvec>(l["group_pop"]), as<uvec>(l["total_pop"]),
-                                        as<double>(l["tgt_group"]), as<double>(l["tgt_other"]),
-                                        as<double>(l["pow"]));
-                });
-
-            lp[i] += add_constraint("compet", constraints,
-                [&] (List l) -> double {
-                    uvec dvote = l["dvote"];
-                    uvec total = dvote + as<uvec>(l["rvote"]);
-                    return eval_grp_pow(districts.col(i), j,
-                                        dvote, total, 0.5, 0.5, as<double>(l["pow"]));
-                });
-
-            lp[i] += add_constraint("grp_hinge", constraints,
-                [&] (List l) -> double {
-                    return eval_grp_hinge(districts.col(i), j, as<vec>(l["tgts_group"]),
-                                          as<uvec>(l["group_pop"]), as<uvec>(l["total_pop"]));
-                });
-
-            lp[i] += add_constraint("grp_inv_hinge", constraints,
-                                    [&] (List l) -> double {
-                                        return eval_grp_hinge(districts.col(i), j, as<vec>(l["tgts_group"]),
-                                                              as<uvec>(l["group_pop"]), as<uvec>(l["total_pop"]));
-                                    });
-
-            lp[i] += add_constraint("incumbency", constraints,
-                [&] (List l) -> double {
-                    return eval_inc(districts.col(i), j, as<uvec>(l["incumbents"]));
-                });
-
-            lp[i] += add_constraint("splits", constraints,
-                [&] (List l) -> double {
-                    return eval_splits(districts.col(i), j, as<uvec>(l["admin"]), l["n"], true);
-                });
-
-            lp[i] += add_constraint("multisplits", constraints,
-                [&] (List l) -> double {
-                    return eval_multisplits(districts.col(i), j, as<uvec>(l["admin"]), l["n"], true);
-                });
-
-            lp[i] += add_constraint("total_splits", constraints,
-                [&] (List l) -> double {
-                    return eval_total_splits(districts.col(i), j, as<uvec>(l["admin"]), l["n"]);
-                });
-
-            lp[i] += add_constraint("polsby", constraints,
-                                      [&] (List l) -> double {
-                                          return eval_polsby(districts.col(i), j,
-                                                             as<ivec>(l["from"]),
-                                                             as<ivec>(l["to"]), as<vec>(l["area"]),
-                                                             as<vec>(l["perimeter"]));
-                                      });
-
-            lp[i] += add_constraint("fry_hold", constraints,
-                                      [&] (List l) -> double {
-                                          return eval_fry_hold(districts.col(i), j,
-                                                               as<uvec>(l["total_pop"]),
-                                                               as<mat>(l["ssdmat"]),
-                                                               as<double>(l["denominator"]));
-                                      });
-
-            lp[i] += add_constraint("qps", constraints,
-                                      [&] (List l) -> double {
-                                          return eval_qps(districts.col(i), j,
-                                                          as<uvec>(l["total_pop"]),
-                                                          as<uvec>(l["cities"]), as<int>(l["n_city"]),
-                                                          n_distr);
-                                      });
-
-            lp[i] += add_constraint("custom", constraints,
-                [&] (List l) -> double {
-                    Function fn = l["fn"];
-                    return as<NumericVector>(fn(districts.col(i), j))[0];
-                });
+            if (term.batch) {
+                NumericVector val = fn(districts, j);
+                if (val.size() != N)
+                    throw std::range_error("Batched custom constraints must return one value per plan.");
+                for (int i = 0; i < N; i++) {
+                    lp[i] += term.strength * val[i];
+                }
+            } else {
+                for (int i = 0; i < N; i++) {
+                    lp[i] += term.strength * eval_constr(constr, term, districts.col(i),
+                                                         no_tally, j, 1);
+                }
+            }
         }
-    } // for
-    } // if
+    }
 
     vec wgt = exp(-alpha * lp);
     if (!final) // not the last iteration
@@ -420,12 +335,12 @@ vec get_wgts(const umat &districts, int n_distr, int distr_ctr, bool final,
 void split_maps(const Graph &g, const uvec &counties, Multigraph &cg,
                 const uvec &pop, umat &districts, vec &cum_wgt, vec &lp,
                 vec &pop_left, vec &log_temper, double pop_temper,
-                double &accept_rate, int n_distr, int dist_ctr,
+                double &accept_rate, double &abort_rate, int n_distr, int dist_ctr,
                 std::vector<Graph> &dist_grs, vec &log_labels,
                 umat &ancestors, const std::vector<int> &lags,
                 bool adjust_labels, double est_label_mult, int &n_unique,
                 double lower, double upper, double target,
-                double rho, int k, bool check_both,
+                double rho, int k, bool check_both, bool multiple_try,
                 RcppThread::ThreadPool &pool, int verbosity,
                 mat &b2_mat, umat &progenitor_mat)
 {
@@ -450,12 +365,22 @@ void split_maps(const Graph &g, const uvec &counties, Multigraph &cg,
     const int reject_check_int = 200; // check for interrupts every _ rejections
     const int check_int = 50; // check for interrupts every _ iterations
     uvec iters(N, fill::zeros); // how many actual iterations
+    uvec aborts(N, fill::zeros); // how many trees were rejected early
 
     rowvec b2_wgts(N);
 
+    // the pool's threads have their own generators, so seed one per particle
+    // from the calling thread, which `set.seed()` controls
+    std::vector<int> seeds(N);
+    for (int i = 0; i < N; i++) {
+        seeds[i] = r_int(INT_MAX);
+    }
+
     RcppThread::ProgressBar bar(N, 1);
     pool.parallelFor(0, N, [&] (int i) {
+        seed_rng(seeds[i]);
         int reject_ct = 0;
+        int n_abort = 0;
         bool ok = false;
         int idx;
         double inc_lp;
@@ -480,7 +405,8 @@ void split_maps(const Graph &g, const uvec &counties, Multigraph &cg,
                 continue;
             }
             inc_lp = split_map(g, counties, cg, districts_new.col(i), dist_ctr,
-                               pop, pop_left(idx), lower_s, upper_s, target, k);
+                               pop, pop_left(idx), lower_s, upper_s, target, k,
+                               multiple_try, n_abort);
 
             // bad sample; try again
             if (!std::isfinite(inc_lp)) {
@@ -491,6 +417,7 @@ void split_maps(const Graph &g, const uvec &counties, Multigraph &cg,
             ok = true;
         }
         uniques[i] = idx;
+        aborts[i] = n_abort;
 
         // save ancestors/lags
         for (int j = 0; j < n_lags; j++) {
@@ -564,8 +491,10 @@ void split_maps(const Graph &g, const uvec &counties, Multigraph &cg,
     progenitor_mat.row(dist_ctr) = uniques + 1;
 
     accept_rate = N / (1.0 * sum(iters));
+    abort_rate = sum(aborts) / (1.0 * sum(iters));
     if (verbosity >= 3) {
-        Rcout << "  " << std::setprecision(2) << 100.0 * accept_rate << "% acceptance rate, ";
+        Rcout << "  " << std::setprecision(2) << 100.0 * accept_rate << "% acceptance rate, "
+              << 100.0 * abort_rate << "% rejected early, ";
     }
 
     b2_mat.row(dist_ctr - 1) = b2_wgts;
@@ -582,10 +511,12 @@ void split_maps(const Graph &g, const uvec &counties, Multigraph &cg,
 
 /*
  * Split a map into two pieces with population lying between `lower` and `upper`
+ * `n_abort` is incremented when the tree is rejected before it is finished
  */
 double split_map(const Graph &g, const uvec &counties, Multigraph &cg,
                  subview_col<uword> districts, int dist_ctr, const uvec &pop,
-                 double total_pop, double &lower, double upper, double target, int k) {
+                 double total_pop, double &lower, double upper, double target, int k,
+                 bool multiple_try, int &n_abort) {
     int V = g.size();
 
     Tree ust = init_tree(V);
@@ -593,27 +524,37 @@ double split_map(const Graph &g, const uvec &counties, Multigraph &cg,
     for (int i = 0; i < V; i++) ignore[i] = districts(i) != 0;
 
     int root;
-    ust = sample_sub_ust(g, ust, V, root, ignore, pop, lower, upper, counties, cg);
-    if (ust.size() == 0) return -std::log(0.0);
+    ust = sample_sub_ust(g, ust, V, root, ignore, pop, lower, upper, counties, cg, true);
+    if (ust.size() == 0) {
+        if (root < 0) n_abort++;
+        return -std::log(0.0);
+    }
 
+    int n_ok;
     double new_pop = cut_districts(ust, k, root, districts, dist_ctr, pop, total_pop,
-                          lower, upper, target);
+                          lower, upper, target, multiple_try, n_ok);
 
     if (new_pop == 0) {
         return -std::log(0.0); // reject sample
     } else {
         lower = new_pop;  // set `lower` as a way to return population of new district
-        return log_boundary(g, districts, 0, dist_ctr);// - log((double) k); (k is constant)
+        double inc_lp = log_boundary(g, districts, 0, dist_ctr);// - log((double) k); (k is constant)
+        // the edge was picked w.p. 1/n_ok rather than 1/k
+        if (multiple_try) inc_lp += std::log((double) k) - std::log((double) n_ok);
+        return inc_lp;
     }
 }
 
 // TESTED
 /*
  * Cut district into two pieces of roughly equal population
+ * With `multiple_try`, picks among the valid edges in the top `k` and stores
+ * how many there were in `n_ok`
  */
 double cut_districts(Tree &ust, int k, int root, subview_col<uword> &districts,
                      int dist_ctr, const uvec &pop, double total_pop,
-                     double lower, double upper, double target) {
+                     double lower, double upper, double target,
+                     bool multiple_try, int &n_ok) {
     int V = ust.size();
     // create list that points to parents & computes population below each vtx
     std::vector<int> pop_below(V, 0);
@@ -645,11 +586,25 @@ double cut_districts(Tree &ust, int k, int root, subview_col<uword> &districts,
     }
     if ((int) candidates.size() < k) return 0.0;
 
-    int idx = r_int(k);
-    idx = select_k(deviances, idx + 1);
+    int idx;
+    if (multiple_try) {
+        // try every edge in the top k at once, rather than rejecting the
+        // tree if a single draw is not valid
+        std::vector<int> top_k = select_top_k(deviances, k);
+        n_ok = 0;
+        for (int i = 0; i < k; i++) {
+            if (is_ok[top_k[i]]) top_k[n_ok++] = top_k[i];
+        }
+        if (n_ok == 0) return 0.0;
+        idx = top_k[r_int(n_ok)];
+    } else {
+        idx = r_int(k);
+        idx = select_k(deviances, idx + 1);
+        n_ok = 1;
+        // reject sample
+        if (!is_ok[idx]) return 0.0;
+    }
     int cut_at = std::fabs(candidates[idx]) - 1;
-    // reject sample
-    if (!is_ok[idx]) return 0.0;
 
     // find index of node to cut at
     std::vector<int> *siblings = &ust[parent[cut_at]];
@@ -712,7 +667,7 @@ void adapt_parameters(const Graph &g, int &k, int last_k, const vec &lp, double
         }
         if (n_vtx > max_V) max_V = n_vtx;
 
-        ust = sample_sub_ust(g, ust, V, root, ignore, pop, lower, upper, counties, cg);
+        ust = sample_sub_ust(g, ust, V, root, ignore, pop, lower, upper, counties, cg, false);
         if (ust.size() == 0) {
             idx--;
             continue;
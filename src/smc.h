@@ -16,6 +16,7 @@
 #include "wilson.h"
 #include "tree_op.h"
 #include "map_calc.h"
+#include "mcmc_gibbs.h"
 #include "labeling.h"
 
 /*
@@ -37,37 +38,42 @@ List smc_plans(int N, List l, const arma::uvec &counties, const arma::uvec &pop,
 void split_maps(const Graph &g, const uvec &counties, Multigraph &cg,
                 const uvec &pop, umat &districts, vec &cum_wgt, vec &lp,
                 vec &pop_left, vec &log_temper, double pop_temper,
-                double &accept_rate, int n_distr, int dist_ctr,
+                double &accept_rate, double &abort_rate, int n_distr, int dist_ctr,
                 std::vector<Graph> &dist_grs, vec &log_labels,
                 umat &ancestors, const std::vector<int> &lags,
                 bool adjust_labels, double est_label_mult, int &n_unique,
                 double lower, double upper, double target,
-                double rho, int k, bool check_both,
+                double rho, int k, bool check_both, bool multiple_try,
                 RcppThread::ThreadPool &pool, int verbosity,
                 mat &b2_mat, umat &progenitor_mat);
 
 
 /*
- * Add specific constraint weights & return the cumulative weight vector
+ * Add specific constraint weights & return the cumulative weight vector.
+ * Constraints evaluated in C++ are evaluated for each plan on `pool`.
  */
 vec get_wgts(const umat &districts, int n_distr, int distr_ctr, bool final,
-             double alpha, vec &lp, double &neff,
-             const uvec &pop, double parity, const Graph g,
-             List constraints, int verbosity);
+             double alpha, vec &lp, double &neff, const constr_registry &constr,
+             RcppThread::ThreadPool &pool, int verbosity);
 
 /*
  * Split a map into two pieces with population lying between `lower` and `upper`
+ * `n_abort` is incremented when the tree is rejected before it is finished
  */
 double split_map(const Graph &g, const uvec &counties, Multigraph &cg,
                  subview_col<uword> districts, int dist_ctr, const uvec &pop,
-                 double total_pop, double &lower, double upper, double target, int k);
+                 double total_pop, double &lower, double upper, double target, int k,
+                 bool multiple_try, int &n_abort);
 
 /*
  * Cut spanning subtree into two pieces of roughly equal population
+ * With `multiple_try`, picks among the valid edges in the top `k` and stores
+ * how many there were in `n_ok`
  */
 double cut_districts(Tree &ust, int k, int root, subview_col<uword> &districts,
                      int dist_ctr, const uvec &pop, double total_pop,
-                     double lower, double upper, double target);
+                     double lower, double upper, double target,
+                     bool multiple_try, int &n_ok);
 
 /*
  * Choose k and multiplier for efficient, accurate sampling
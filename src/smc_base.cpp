@@ -47,6 +47,32 @@ int select_k(std::vector<double> x, int k) {
     }
 }
 
+/*
+ * Get the indices of the k smallest elements of x, in no particular order
+ */
+std::vector<int> select_top_k(std::vector<double> x, int k) {
+    int right = x.size() - 1;
+    int left = 0;
+    std::vector<int> idxs(right + 1);
+    for (int i = 0; i <= right; i++) idxs[i] = i;
+
+    k--;
+    while (left < right) {
+        int pivot = left + r_int(right - left + 1);
+        partition_vec(x, idxs, left, right, pivot);
+        if (k == pivot) {
+            break;
+        } else if (k < pivot) {
+            right = pivot - 1;
+        } else {
+            left = pivot + 1;
+        }
+    }
+
+    idxs.resize(k + 1);
+    return idxs;
+}
+
 List cli_config(bool clear, const char * fmt) {
     return List::create(_["clear"]=clear, _["show_after"]=0.25,
                         _["format"]=fmt);
@@ -24,6 +24,11 @@ using namespace arma;
  */
 int select_k(std::vector<double> x, int k);
 
+/*
+ * Get the indices of the k smallest elements of x, in no particular order
+ */
+std::vector<int> select_top_k(std::vector<double> x, int k);
+
 /*
  * Make a progress bar configuration with format string `fmt`
  */
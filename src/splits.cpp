@@ -1,29 +1,38 @@
 #include "smc_base.h"
-#include <redistmetrics.h>
+#include "map_calc.h"
 
 // [[Rcpp::export]]
 IntegerVector splits(IntegerMatrix dm, IntegerVector community, int nd, int max_split) {
-    return redistmetrics::splits(dm, community, nd, max_split);
+    umat plans = conv_to<umat>::from(as<imat>(dm) + 1);
+    uvec counties = conv_to<uvec>::from(as<ivec>(community) + 1);
+    int n_cty = max(counties);
+    nd = std::max(nd, (int) plans.max());
+    int N = plans.n_cols;
+
+    IntegerVector ret(N);
+    cty_incidence inc;
+    for (int c = 0; c < N; c++) {
+        tally_counties(inc, plans.col(c), counties, n_cty, nd);
+        ret[c] = accu(inc.n_distr > (uword) max_split);
+    }
+    return ret;
 }
+
 // [[Rcpp::export]]
 IntegerMatrix dist_cty_splits(IntegerMatrix dm, IntegerVector community, int nd) {
-  IntegerMatrix ret(nd, dm.ncol());
-  IntegerVector com_name = sort_unique(community);
-  IntegerVector com_found(com_name.size(), 0);
+  umat plans = conv_to<umat>::from(as<imat>(dm) + 1);
+  uvec counties = conv_to<uvec>::from(as<ivec>(community) + 1);
+  int n_cty = max(counties);
+  int N = plans.n_cols;
+  IntegerMatrix ret(nd, N);
 
-  // by column (aka map)
-  for(int c = 0; c < dm.ncol(); c++){
-    // by district
-   for(int d = 0; d < nd; d++){
-     com_found = IntegerVector(com_found.size(), 0);
-     // across all rows
-     for(int r = 0; r < dm.nrow(); r++){
-       if (dm(r,c) == d) {
-         com_found(community(r)) = 1;
-       }
-     }
-     ret(d, c) = sum(com_found);
-   }
+  // by column (aka map), counting the counties found in each district
+  cty_incidence inc;
+  for(int c = 0; c < N; c++){
+    tally_counties(inc, plans.col(c), counties, n_cty, std::max(nd, (int) max(plans.col(c))));
+    for(int d = 0; d < nd; d++){
+      ret(d, c) = accu(inc.count.col(d + 1) > 0);
+    }
   }
   return ret;
 }
@@ -191,13 +191,7 @@ List swMH(List aList,
     NumericVector energy_store(nsims);
 
     NumericVector psi_upd;
-    CharacterVector psi_names = CharacterVector::create(
-        "pop_dev", "splits", "multisplits",
-        "segregation", "grp_pow", "grp_hinge", "grp_inv_hinge",
-        "compet", "status_quo", "incumbency",
-        "polsby", "fry_hold", "log_st", "edges_removed",
-        "qps", "custom"
-    );
+    CharacterVector psi_names = constr_names();
 
     NumericMatrix psi_store(psi_names.size(), nsims);
     rownames(psi_store) = psi_names;
@@ -242,6 +236,10 @@ List swMH(List aList,
 
     RObject bar = cli_progress_bar(nsims, cli_config(false));
     Graph g = list_to_graph(aList);
+    // constraints are extracted once, rather than at every proposal
+    constr_registry constr = make_constr_registry(
+        constraints, arma::conv_to<arma::uvec>::from(as<arma::vec>(popvec)),
+        max(cdvec) + 1, parity, g, false);
     // Open the simulations
     while(k < nsims){
 
@@ -289,8 +287,7 @@ List swMH(List aList,
                                          cdvec,
                                          popvec,
                                          district_pops,
-                                         constraints,
-                                         psi_names,
+                                         constr,
                                          min_parity,
                                          max_parity,
                                          parity,
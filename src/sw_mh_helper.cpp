@@ -387,8 +387,7 @@ List make_swaps(List boundary_cc,
                 NumericVector cds_old,
                 NumericVector pop_vec,
                 NumericVector cd_pop_vec,
-                List constraints,
-                CharacterVector psi_names,
+                const constr_registry &constr,
                 double minparity,
                 double maxparity,
                 double parity,
@@ -447,6 +446,7 @@ List make_swaps(List boundary_cc,
   // Initialize metropolis-hastings probabilities
   double mh_prob = 1.0;
 
+  CharacterVector psi_names = constr_names();
   NumericVector old_psi(psi_names.size());
   old_psi.names() = psi_names;
   NumericVector new_psi(psi_names.size());
@@ -648,13 +648,20 @@ List make_swaps(List boundary_cc,
       districts(r, 1) = cds_old(r) + 1;
   }
   arma::umat udistricts = conv_to<umat>::from(districts);
-  arma::uvec pops = conv_to<arma::uvec>::from(as<arma::vec>(pop_vec));
 
   // Multiply mh_prob by constraint values
-  double energy_new = calc_gibbs_tgt(udistricts.col(0), ndists, nprec, swaps_v,
-                                     new_psi, pops, parity, g, constraints);
-  double energy_old = calc_gibbs_tgt(udistricts.col(1), ndists, nprec, swaps_v,
-                                     old_psi, pops, parity, g, constraints);
+  district_tally dt_new = tally_plan(udistricts.col(0), constr.tally, ndists);
+  district_tally dt_old = tally_plan(udistricts.col(1), constr.tally, ndists);
+  vec psi_new(N_CONSTR_TYPES, fill::zeros);
+  vec psi_old(N_CONSTR_TYPES, fill::zeros);
+  double energy_new = calc_gibbs_tgt(constr, udistricts.col(0), dt_new, swaps_v,
+                                     CONSTR_ALL, &psi_new);
+  double energy_old = calc_gibbs_tgt(constr, udistricts.col(1), dt_old, swaps_v,
+                                     CONSTR_ALL, &psi_old);
+  for (int t = 0; t < N_CONSTR_TYPES; t++) {
+      new_psi[t] = psi_new[t];
+      old_psi[t] = psi_old[t];
+  }
 
   mh_prob = (double)mh_prob * exp(-1.0 * beta * (energy_new - energy_old));
 
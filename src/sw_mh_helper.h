@@ -31,8 +31,7 @@ Rcpp::List make_swaps(Rcpp::List boundary_cc,
 		      Rcpp::NumericVector cds_old,
 		      Rcpp::NumericVector pop_vec,
 		      Rcpp::NumericVector cd_pop_vec,
-		      Rcpp::List constraints,
-		      CharacterVector psi_names,
+		      const constr_registry &constr,
 		      double minparity,
 		      double maxparity,
 		      double parity,
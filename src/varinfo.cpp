@@ -1,34 +1,229 @@
 #include <RcppArmadillo.h>
+#include <RcppThread.h>
+#include <cstdint>
 using namespace Rcpp;
+using namespace arma;
 
-double var_info(IntegerVector m1, IntegerVector m2, NumericVector pop, int k) {
-    int V = m1.size();
-    NumericMatrix joint(k);
-    NumericVector p1(k);
-    NumericVector p2(k);
+/*
+ * Distances between plans, from `plan_dist_type()`
+ */
+enum dist_type {
+    DIST_VI,
+    DIST_HAMMING,
+    DIST_POP_HAMMING
+};
 
-    double total_pop = 0;
-    for (int i = 0; i < V; i++) {
-        joint(m1[i]-1, m2[i]-1) += pop[i];
-        p1[m1[i]-1] += pop[i];
-        p2[m2[i]-1] += pop[i];
-        total_pop += pop[i];
+/*
+ * Plans stored one after another with 0-indexed labels, along with what each
+ * distance needs from a single plan
+ */
+struct plan_store {
+    int V;
+    int N;
+    int k; // number of districts
+    std::vector<uint16_t> labels; // plan `n` starts at `n * V`
+    std::vector<double> log_pop; // log population of district `d` of plan `n` at `n * k + d`
+};
+
+/*
+ * Scratch space for one thread: a `k` by `k` joint population table, and
+ * the cells which are nonzero, so that only those need to be read and reset
+ */
+struct dist_scratch {
+    std::vector<double> joint;
+    std::vector<int> used;
+};
+
+/*
+ * Convert a distance name from R
+ */
+static dist_type plan_dist_type(std::string measure) {
+    if (measure == "VI") return DIST_VI;
+    if (measure == "Hamming") return DIST_HAMMING;
+    if (measure == "PopHamming") return DIST_POP_HAMMING;
+    throw std::invalid_argument("Unknown distance `" + measure + "`.");
+}
+
+/*
+ * Copy the plans (columns of `m`, 1-indexed) into a `plan_store`
+ */
+static plan_store make_plan_store(const IntegerMatrix &m, const vec &pop, dist_type type) {
+    plan_store ps;
+    ps.V = m.nrow();
+    ps.N = m.ncol();
+    ps.k = 0;
+    ps.labels.resize((size_t) ps.V * ps.N);
+    const int *m_mem = m.begin();
+    for (size_t i = 0; i < ps.labels.size(); i++) {
+        if (m_mem[i] < 1 || m_mem[i] > 65535)
+            throw std::range_error("Plans must be 1-indexed with fewer than 65536 districts.");
+        ps.labels[i] = m_mem[i] - 1;
+        ps.k = std::max(ps.k, m_mem[i]);
     }
 
-    double varinf = 0;
-    for (int i = 0; i < k; i++) {
-        for (int j = 0; j < k; j++) {
-            double jo = joint(i, j);
-            if (jo < 1) continue;
-            varinf -= (jo / total_pop) * (2.0*std::log(jo) - std::log(p1[i]) - std::log(p2[j]));
+    if (type == DIST_VI) {
+        ps.log_pop.assign((size_t) ps.k * ps.N, 0.0);
+        for (int n = 0; n < ps.N; n++) {
+            double *distr_pop = &ps.log_pop[(size_t) n * ps.k];
+            const uint16_t *plan = &ps.labels[(size_t) n * ps.V];
+            for (int i = 0; i < ps.V; i++) {
+                distr_pop[plan[i]] += pop[i];
+            }
+            for (int d = 0; d < ps.k; d++) {
+                distr_pop[d] = std::log(distr_pop[d]);
+            }
         }
     }
 
+    return ps;
+}
+
+/*
+ * Variation of information from the joint populations in `scr`, given the log
+ * district populations of both plans. Clears `scr` for the next pair.
+ */
+static double var_info_joint(dist_scratch &scr, int k, const double *lp1,
+                             const double *lp2, double total_pop) {
+    double varinf = 0;
+    for (int cell : scr.used) {
+        double jo = scr.joint[cell];
+        scr.joint[cell] = 0;
+        if (jo < 1) continue;
+        varinf -= (jo / total_pop) * (2.0*std::log(jo) - lp1[cell / k] - lp2[cell % k]);
+    }
+    scr.used.clear();
+
     if (std::fabs(varinf) <= 1e-9)
         varinf = 0;
     return varinf;
 }
 
+/*
+ * Variation of information between plans `a` and `b`
+ */
+static double var_info(const plan_store &ps, int a, int b, const vec &pop,
+                       double total_pop, dist_scratch &scr) {
+    const uint16_t *x = &ps.labels[(size_t) a * ps.V];
+    const uint16_t *y = &ps.labels[(size_t) b * ps.V];
+    int k = ps.k;
+    for (int i = 0; i < ps.V; i++) {
+        int cell = x[i] * k + y[i];
+        if (scr.joint[cell] == 0) scr.used.push_back(cell);
+        scr.joint[cell] += pop[i];
+    }
+
+    return var_info_joint(scr, k, &ps.log_pop[(size_t) a * k],
+                          &ps.log_pop[(size_t) b * k], total_pop);
+}
+
+/*
+ * Distance between plans `a` and `b`
+ */
+static double plan_dist(const plan_store &ps, int a, int b, dist_type type,
+                        const vec &pop, double total_pop, dist_scratch &scr) {
+    if (type == DIST_VI) return var_info(ps, a, b, pop, total_pop, scr);
+
+    const uint16_t *x = &ps.labels[(size_t) a * ps.V];
+    const uint16_t *y = &ps.labels[(size_t) b * ps.V];
+    double dist = 0;
+    if (type == DIST_HAMMING) {
+        int n_diff = 0;
+        for (int i = 0; i < ps.V; i++) {
+            n_diff += x[i] != y[i];
+        }
+        dist = n_diff;
+    } else {
+        for (int i = 0; i < ps.V; i++) {
+            if (x[i] != y[i]) dist += pop[i];
+        }
+    }
+    return dist;
+}
+
+/*
+ * Compute the distance `measure` ("VI", "Hamming", or "PopHamming") between
+ * every pair of plans (columns of `m`, 1-indexed), weighting precincts by `pop`
+ */
+// [[Rcpp::export]]
+arma::mat plan_dist_mat(const IntegerMatrix &m, const arma::vec &pop,
+                        std::string measure, int ncores = 1) {
+    dist_type type = plan_dist_type(measure);
+    plan_store ps = make_plan_store(m, pop, type);
+    int N = ps.N;
+    double total_pop = sum(pop);
+    mat out(N, N, fill::zeros);
+
+    // blocks of plans small enough that both stay in cache, each computing
+    // only the lower triangle and copying it to the upper
+    const int TILE = 32;
+    int n_tiles = (N + TILE - 1) / TILE;
+    std::vector<std::pair<int, int>> tiles;
+    for (int ti = 0; ti < n_tiles; ti++) {
+        for (int tj = 0; tj <= ti; tj++) {
+            tiles.push_back(std::make_pair(ti, tj));
+        }
+    }
+
+    RcppThread::ThreadPool pool(ncores > 1 ? ncores : 0);
+    pool.parallelFor(0, (int) tiles.size(), [&] (int t) {
+        dist_scratch scr;
+        if (type == DIST_VI) scr.joint.assign(ps.k * ps.k, 0.0);
+        int ti = tiles[t].first;
+        int tj = tiles[t].second;
+        int i_end = std::min(N, (ti + 1) * TILE);
+        int j_end = std::min(N, (tj + 1) * TILE);
+        for (int i = ti * TILE; i < i_end; i++) {
+            int j_max = ti == tj ? i : j_end;
+            for (int j = tj * TILE; j < j_max; j++) {
+                double dist = plan_dist(ps, i, j, type, pop, total_pop, scr);
+                out(i, j) = dist;
+                out(j, i) = dist;
+            }
+        }
+    });
+    pool.wait();
+    pool.join();
+
+    return out;
+}
+
+/*
+ * Compute the distance `measure` between plans `i` and `j` (1-indexed) of the
+ * plans in `m`, for each pair of entries of `i` and `j`
+ */
+// [[Rcpp::export]]
+NumericVector plan_dist_pairs(const IntegerMatrix &m, const arma::uvec &i,
+                              const arma::uvec &j, const arma::vec &pop,
+                              std::string measure, int ncores = 1) {
+    if (i.n_elem != j.n_elem)
+        throw std::range_error("Pairs of plans must have the same length.");
+    dist_type type = plan_dist_type(measure);
+    plan_store ps = make_plan_store(m, pop, type);
+    int n_pairs = i.n_elem;
+    double total_pop = sum(pop);
+    for (int p = 0; p < n_pairs; p++) {
+        if (i[p] < 1 || i[p] > (uword) ps.N || j[p] < 1 || j[p] > (uword) ps.N)
+            throw std::range_error("Plan indices must be in range.");
+    }
+
+    NumericVector out(n_pairs);
+    double *out_mem = out.begin();
+    const int CHUNK = 256;
+    int n_chunks = (n_pairs + CHUNK - 1) / CHUNK;
+    RcppThread::ThreadPool pool(ncores > 1 ? ncores : 0);
+    pool.parallelFor(0, n_chunks, [&] (int c) {
+        dist_scratch scr;
+        if (type == DIST_VI) scr.joint.assign(ps.k * ps.k, 0.0);
+        int p_end = std::min(n_pairs, (c + 1) * CHUNK);
+        for (int p = c * CHUNK; p < p_end; p++) {
+            out_mem[p] = plan_dist(ps, i[p] - 1, j[p] - 1, type, pop, total_pop, scr);
+        }
+    });
+    pool.wait();
+    pool.join();
+
+    return out;
+}
 
 /*
  * `m` has rows = precincts, cols = plans
@@ -38,11 +233,46 @@ double var_info(IntegerVector m1, IntegerVector m2, NumericVector pop, int k) {
 // [[Rcpp::export]]
 NumericVector var_info_vec(IntegerMatrix m, IntegerVector ref, NumericVector pop) {
     int N = m.ncol();
+    int V = m.nrow();
+    if (ref.size() != V || pop.size() != V)
+        throw std::range_error("Reference plan and population must match the plans.");
+
+    // read each plan in place, against the district populations of `ref`
+    int k = 0;
+    for (int i = 0; i < V; i++) {
+        if (ref[i] < 1) throw std::range_error("Plans must be 1-indexed.");
+        k = std::max(k, ref[i]);
+    }
+    for (R_xlen_t i = 0; i < m.size(); i++) {
+        if (m[i] < 1) throw std::range_error("Plans must be 1-indexed.");
+        k = std::max(k, m[i]);
+    }
+    double total_pop = sum(pop);
+    std::vector<double> lp_ref(k, 0.0);
+    for (int i = 0; i < V; i++) {
+        lp_ref[ref[i] - 1] += pop[i];
+    }
+    for (int d = 0; d < k; d++) {
+        lp_ref[d] = std::log(lp_ref[d]);
+    }
 
     NumericVector out(N);
-    int k = max(ref);
+    std::vector<double> lp_plan(k);
+    dist_scratch scr;
+    scr.joint.assign((size_t) k * k, 0.0);
     for (int j = 0; j < N; j++) {
-        out[j] = var_info(ref, m(_, j), pop, k);
+        const int *plan = m.begin() + (size_t) V * j;
+        std::fill(lp_plan.begin(), lp_plan.end(), 0.0);
+        for (int i = 0; i < V; i++) {
+            int cell = (ref[i] - 1) * k + plan[i] - 1;
+            if (scr.joint[cell] == 0) scr.used.push_back(cell);
+            scr.joint[cell] += pop[i];
+            lp_plan[plan[i] - 1] += pop[i];
+        }
+        for (int d = 0; d < k; d++) {
+            lp_plan[d] = std::log(lp_plan[d]);
+        }
+        out[j] = var_info_joint(scr, k, lp_ref.data(), lp_plan.data(), total_pop);
     }
 
     return out;
@@ -39,17 +39,19 @@ Tree sample_ust(List l, const arma::uvec &pop, double lower, double upper,
     Tree tree = init_tree(V);
     int root;
     const std::vector<bool> ignore(V, false);
-    return sample_sub_ust(g, tree, V, root, ignore, pop, lower, upper, counties, cg);
+    return sample_sub_ust(g, tree, V, root, ignore, pop, lower, upper, counties, cg, false);
 }
 
 /*
  * Sample a uniform spanning subtree of unvisited nodes using Wilson's algorithm
+ * If `early_abort` is true and no edge can yield a piece with population
+ * between `lower` and `upper`, returns an empty tree and sets `root` to -1.
  */
 // TESTED
 Tree sample_sub_ust(const Graph &g, Tree &tree, int V, int &root,
                     const std::vector<bool> &ignore, const uvec &pop,
                     double lower, double upper,
-                    const uvec &counties, Multigraph &mg) {
+                    const uvec &counties, Multigraph &mg, bool early_abort) {
     int n_county = mg.size();
     std::vector<bool> visited(V, false);
     std::vector<bool> c_visited(n_county, true);
@@ -114,12 +116,22 @@ Tree sample_sub_ust(const Graph &g, Tree &tree, int V, int &root,
         }
     }
 
-    // figure out which counties will not need to be split
+    // figure out which counties will not need to be split, and whether any
+    // edge of the final tree could possibly produce a balanced cut
     if (n_county > 1) {
+    int root_cty = counties[root] - 1;
     std::vector<int> cty_pop_below(n_county, -1);
     std::vector<int> cty_parent(n_county);
-    tree_pop(cty_tree, counties[root] - 1, county_pop, cty_pop_below, cty_parent);
+    tree_pop(cty_tree, root_cty, county_pop, cty_pop_below, cty_parent);
+    bool any_cut = false;
     for (int i = 0; i < n_county; i++) {
+        // edge joining this county to its parent in the county tree
+        if (cty_pop_below[i] >= 0 && i != root_cty && !any_cut) {
+            int below = cty_pop_below[i];
+            any_cut = (lower <= below && below <= upper) ||
+                (lower <= tot_pop - below && tot_pop - below <= upper);
+        }
+
         int n_vtx = county_members[i].size();
         if (n_vtx <= 1) continue;
         // check child counties
@@ -156,8 +168,17 @@ Tree sample_sub_ust(const Graph &g, Tree &tree, int V, int &root,
             if (cty_root < n_vtx - 1) {
                 tree.at(county_members[i][cty_root]).push_back(county_members[i][n_vtx-1]);
             }
+        } else {
+            any_cut = true;
         }
     }
+
+    // every edge would be rejected later, so skip the walks within counties
+    if (early_abort && !any_cut) {
+        root = -1;
+        Tree null_tree;
+        return null_tree;
+    }
     }
 
     // Generate tree within each county
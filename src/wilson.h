@@ -5,10 +5,12 @@
 
 /*
  * Sample a uniform spanning subtree of unvisited nodes using Wilson's algorithm
+ * If `early_abort` is true and no edge can yield a piece with population
+ * between `lower` and `upper`, returns an empty tree and sets `root` to -1.
  */
 Tree sample_sub_ust(const Graph &g, Tree &tree, int V, int &root,
                     const std::vector<bool> &ignore, const uvec &pop,
                     double lower, double upper,
-                    const uvec &counties, Multigraph &mg);
+                    const uvec &counties, Multigraph &mg, bool early_abort);
 
 #endif